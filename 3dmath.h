@@ -303,6 +303,9 @@ static INLINE vec2_t vec3_xz(vec3_t v)                      { return vec2(v.x, v
 static INLINE vec2_t vec3_yx(vec3_t v)                      { return vec2(v.y, v.x); }
 static INLINE vec2_t vec3_zy(vec3_t v)                      { return vec2(v.z, v.y); }
 static INLINE vec2_t vec3_zx(vec3_t v)                      { return vec2(v.z, v.x); }
+
+/* component by axis index (0: x, 1: y, 2: z) */
+static INLINE float  vec3_axis(vec3_t v, unsigned int axis)  { return (axis == 0) ? v.x : ((axis == 1) ? v.y : v.z); }
 /* double */
 static INLINE dvec2_t dvec2_neg(dvec2_t v)					{	return dvec2( -v.x, -v.y );		}
 static INLINE dvec3_t dvec3_neg(dvec3_t v)					{	return dvec3( -v.x, -v.y, -v.z );	}
@@ -603,6 +606,27 @@ box3_intersect(box3_t a, box3_t b) {
 static INLINE vec3_t        box3_center(box3_t b) { return vec3_mulf(vec3_add(b.max, b.min), 0.5f); }
 static INLINE vec3_t        box3_extent(box3_t b) { vec3_t c = box3_center(b); return vec3_sub(b.max, c); }
 
+/* inverted (empty) box, the identity of box3_union/box3_expand */
+static INLINE box3_t        box3_empty()                    { box3_t b; b.min = vec3(FLT_MAX, FLT_MAX, FLT_MAX); b.max = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX); return b; }
+static INLINE box3_t        box3_union(box3_t a, box3_t b)  { box3_t r; r.min = vec3_min(a.min, b.min); r.max = vec3_max(a.max, b.max); return r; }
+static INLINE box3_t        box3_expand(box3_t b, vec3_t p) { box3_t r; r.min = vec3_min(b.min, p); r.max = vec3_max(b.max, p); return r; }
+
+static INLINE
+float
+box3_surface_area(box3_t b) {
+    vec3_t  d   = vec3_sub(b.max, b.min);
+    if( d.x < 0.0f || d.y < 0.0f || d.z < 0.0f ) return 0.0f;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+/* squared distance from a point to a box, 0 inside */
+static INLINE
+float
+box3_sqr_distance(box3_t b, vec3_t p) {
+    vec3_t  d   = vec3_sub(vec3_max(b.min, vec3_min(p, b.max)), p);
+    return vec3_dot(d, d);
+}
+
 static INLINE
 bool
 box3_overlap(box3_t a, box3_t b) {
@@ -617,7 +641,10 @@ box3_overlap(box3_t a, box3_t b) {
     return true;
 }
 
+/*! @brief split a box into its 8 octants */
 DLL_3DMATH_PUBLIC void      box3_subdivide(box3_t b, box3_t out[8]);
+/*! @brief index (in box3_subdivide order) of the octant containing pt */
+DLL_3DMATH_PUBLIC uint32_t  box3_octant(box3_t b, vec3_t pt);
 
 /*******************************************************************************
 ** ray3
@@ -640,6 +667,34 @@ static INLINE vec3_t		ray3_at(ray3_t r, float t)			{	return vec3_add(vec3_mulf(r
 */
 static INLINE ray3_t		ray3_normalize(ray3_t r)			{	ray3_t ret; ret.start = r.start; r.direction = vec3_normalize(r.direction);	return ret;	}
 
+/*******************************************************************************
+**  ray3_inv
+**
+**  A ray with its reciprocal direction and direction sign bits precomputed.
+**  Build it once and reuse it when the same ray is tested against many boxes.
+*******************************************************************************/
+typedef struct {
+    vec3_t          start;
+    vec3_t          direction;
+    vec3_t          inv_direction;  /* 1 / direction, +/-INFINITY on zero components */
+    int             sign[3];        /* 1 if the direction component is negative */
+} ray3_inv_t;
+
+static INLINE
+ray3_inv_t
+ray3_inv(ray3_t r) {
+    ray3_inv_t  ri;
+    ri.start            = r.start;
+    ri.direction        = r.direction;
+    ri.inv_direction    = vec3(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+    ri.sign[0]          = ri.inv_direction.x < 0.0f;
+    ri.sign[1]          = ri.inv_direction.y < 0.0f;
+    ri.sign[2]          = ri.inv_direction.z < 0.0f;
+    return ri;
+}
+
+static INLINE ray3_t        ray3_of_ray3_inv(ray3_inv_t r)      {	return ray3_from(r.start, r.direction);	}
+
 /*******************************************************************************
 **  line3
 **
@@ -699,6 +754,40 @@ plane_normalize(plane_t p) {
     return plane_from(vec3_divf(plane_normal(p), l), p.d * l);
 }
 
+/*******************************************************************************
+**  sphere, capsule and oriented box
+*******************************************************************************/
+typedef struct {
+    vec3_t          center;
+    float           radius;
+} sphere_t;
+
+/* all the points within radius of the segment */
+typedef struct {
+    segment3_t      axis;
+    float           radius;
+} capsule_t;
+
+typedef struct {
+    vec3_t          center;
+    mat3_t          axes;       /* orthonormal, column i is the local axis i */
+    vec3_t          extents;    /* half sizes along the local axes */
+} obb3_t;
+
+static INLINE sphere_t      sphere(vec3_t center, float radius)                 { sphere_t s; s.center = center; s.radius = radius; return s; }
+static INLINE capsule_t     capsule(segment3_t axis, float radius)              { capsule_t c; c.axis = axis; c.radius = radius; return c; }
+static INLINE obb3_t        obb3(vec3_t center, mat3_t axes, vec3_t extents)    { obb3_t o; o.center = center; o.axes = axes; o.extents = extents; return o; }
+static INLINE obb3_t        obb3_from_quat(vec3_t center, quat_t rot, vec3_t extents)   { return obb3(center, mat3_from_quat(rot), extents); }
+static INLINE obb3_t        obb3_from_box3(box3_t b)                            { return obb3(box3_center(b), mat3_identity(), box3_extent(b)); }
+
+/* point from world to obb local coordinates */
+static INLINE
+vec3_t
+obb3_to_local(obb3_t o, vec3_t p) {
+    vec3_t  d   = vec3_sub(p, o.center);
+    return vec3(vec3_dot(d, o.axes.col[0]), vec3_dot(d, o.axes.col[1]), vec3_dot(d, o.axes.col[2]));
+}
+
 /*******************************************************************************
 **  tri3
 *******************************************************************************/
@@ -778,6 +867,12 @@ DLL_3DMATH_PUBLIC float             line3_line3_distance(line3_t l0, line3_t l1)
 DLL_3DMATH_PUBLIC vec2_t            closest_point_on_segment2(vec2_t start, vec2_t end, vec2_t pt);
 DLL_3DMATH_PUBLIC vec3_t            closest_point_on_segment3(segment3_t seg, vec3_t pt);
 
+/*!
+ @brief closest point of a triangle to pt (vertex, edge and face regions)
+ @param uv [out] barycentrics of the closest point with respect to v1 and v2 (optional)
+*/
+DLL_3DMATH_PUBLIC vec3_t            closest_point_on_tri3(vec3_t v0, vec3_t v1, vec3_t v2, vec3_t pt, vec2_t* uv);
+
 DLL_3DMATH_PUBLIC vec2_t            closest_point_on_line2(line2_t l, vec2_t pt);
 DLL_3DMATH_PUBLIC vec3_t            closest_point_on_line3(line3_t l, vec3_t pt);
 
@@ -791,8 +886,69 @@ DLL_3DMATH_PUBLIC bool              line3_line3_shortest_segment(line3_t l0, lin
 
 DLL_3DMATH_PUBLIC bool              intersect_box3_sphere(box3_t b, vec3_t c, float r);
 DLL_3DMATH_PUBLIC bool              intersect_box3_ray3(box3_t b, ray3_t r);
+
+/*!
+ @brief slab test of a precomputed ray against a box, restricted to [t0, t1]
+ @param tmin [out] entry distance along the ray (optional)
+ @param tmax [out] exit distance along the ray (optional)
+ @return true if the ray overlaps the box inside [t0, t1]
+*/
+DLL_3DMATH_PUBLIC bool              intersect_box3_ray3_inv(box3_t b, ray3_inv_t r, float t0, float t1, float* tmin, float* tmax);
+
+/*!
+ @brief slab test of a precomputed ray against an array of boxes, restricted to [t0, t1]
+ @param tmin [out] per box entry distance (optional)
+ @param tmax [out] per box exit distance (optional)
+ @param hits [out] per box hit flag
+ @return the number of boxes hit
+*/
+DLL_3DMATH_PUBLIC uint32_t          intersect_box3_array_ray3_inv(const box3_t* boxes, uint32_t count, ray3_inv_t r, float t0, float t1, float* tmin, float* tmax, bool* hits);
+
 DLL_3DMATH_PUBLIC bool              intersect_tri3_sphere(vec3_t v0, vec3_t v1, vec3_t v2, vec3_t center, float radius);
 
+/*! @brief exact separating axis test of a triangle against a box (touching counts as overlap) */
+DLL_3DMATH_PUBLIC bool              intersect_box3_tri3(box3_t b, vec3_t v0, vec3_t v1, vec3_t v2);
+
+/*! @brief closest points of two segments, returns their squared distance */
+DLL_3DMATH_PUBLIC float             segment3_segment3_closest(segment3_t s0, segment3_t s1, vec3_t* out0, vec3_t* out1);
+
+/*! @brief closest point of an oriented box to pt (pt itself when inside) */
+DLL_3DMATH_PUBLIC vec3_t            closest_point_on_obb3(obb3_t o, vec3_t pt);
+
+/** @name sphere, capsule and oriented box overlaps (touching counts as overlap)
+ @{ */
+DLL_3DMATH_PUBLIC bool              intersect_sphere_sphere(sphere_t a, sphere_t b);
+DLL_3DMATH_PUBLIC bool              intersect_sphere_capsule(sphere_t s, capsule_t c);
+DLL_3DMATH_PUBLIC bool              intersect_sphere_obb3(sphere_t s, obb3_t o);
+DLL_3DMATH_PUBLIC bool              intersect_capsule_capsule(capsule_t a, capsule_t b);
+DLL_3DMATH_PUBLIC bool              intersect_capsule_obb3(capsule_t c, obb3_t o);
+
+/*! @brief 15 axis separating axis test, exits at the first separating axis */
+DLL_3DMATH_PUBLIC bool              intersect_obb3_obb3(obb3_t a, obb3_t b);
+/** @} */
+
+/** @name ray casts
+ t is the entry distance along the ray in units of its direction, 0 when the
+ ray starts inside.
+ @{ */
+DLL_3DMATH_PUBLIC bool              ray3_sphere_intersection(ray3_t r, sphere_t s, float* t);
+DLL_3DMATH_PUBLIC bool              ray3_capsule_intersection(ray3_t r, capsule_t c, float* t);
+DLL_3DMATH_PUBLIC bool              ray3_obb3_intersection(ray3_t r, obb3_t o, float* t);
+/** @} */
+
+/** @name batches
+ One shape against an array: hits[i] is set per element, t[i] (optional) is
+ the ray entry distance of the hit elements. They return the hit count.
+ @{ */
+DLL_3DMATH_PUBLIC uint32_t          intersect_sphere_array_sphere(const sphere_t* spheres, uint32_t count, sphere_t s, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_sphere_array_ray3(const sphere_t* spheres, uint32_t count, ray3_t r, float* t, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_capsule_array_sphere(const capsule_t* capsules, uint32_t count, sphere_t s, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_capsule_array_ray3(const capsule_t* capsules, uint32_t count, ray3_t r, float* t, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_obb3_array_sphere(const obb3_t* obbs, uint32_t count, sphere_t s, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_obb3_array_obb3(const obb3_t* obbs, uint32_t count, obb3_t o, bool* hits);
+DLL_3DMATH_PUBLIC uint32_t          intersect_obb3_array_ray3(const obb3_t* obbs, uint32_t count, ray3_t r, float* t, bool* hits);
+/** @} */
+
 /*******************************************************************************
 **
 ** transforms
@@ -911,6 +1067,1021 @@ DLL_3DMATH_PUBLIC vec4_t			transform_vec4(mat4_t m, vec4_t in);
  */
 DLL_3DMATH_PUBLIC bool				mat4_decompose(mat4_t m, vec3_t *scale, quat_t *rot, vec3_t *trans);
 
+/*******************************************************************************
+**
+** triangle meshes
+**
+*******************************************************************************/
+/*
+** Indexed triangle mesh view. The mesh does not own its arrays, the caller keeps
+** them alive for as long as the mesh (or any structure built over it) is in use.
+*/
+typedef struct {
+    const vec3_t*       vertices;
+    const uint32_t*     indices;    /* 3 per triangle, NULL for a triangle soup (3 vertices per triangle) */
+    uint32_t            tri_count;
+} tri3_mesh_t;
+
+static INLINE tri3_mesh_t   tri3_mesh(const vec3_t* vertices, const uint32_t* indices, uint32_t tri_count) { tri3_mesh_t m; m.vertices = vertices; m.indices = indices; m.tri_count = tri_count; return m; }
+
+static INLINE
+void
+tri3_mesh_triangle(tri3_mesh_t m, uint32_t tri, vec3_t* v0, vec3_t* v1, vec3_t* v2) {
+    if( m.indices ) {
+        *v0 = m.vertices[m.indices[3 * tri]];
+        *v1 = m.vertices[m.indices[3 * tri + 1]];
+        *v2 = m.vertices[m.indices[3 * tri + 2]];
+    } else {
+        *v0 = m.vertices[3 * tri];
+        *v1 = m.vertices[3 * tri + 1];
+        *v2 = m.vertices[3 * tri + 2];
+    }
+}
+
+/* ray/triangle hit record */
+typedef struct {
+    float               t;          /* parametric distance along the ray */
+    float               u, v;       /* barycentric coordinates of the hit (w.r.t. v1 and v2) */
+    uint32_t            tri;        /* triangle index */
+} tri3_hit_t;
+
+/*******************************************************************************
+**
+** triangle groups
+**
+** Triangles with precomputed edges, transposed in groups of TRI3_GROUP_SIZE so
+** one ray is tested against a whole group at once. Unused lanes have zero edges
+** and never report a hit.
+*******************************************************************************/
+#ifndef TRI3_GROUP_SIZE
+#   define TRI3_GROUP_SIZE      8   /* 4 or 8 */
+#endif
+
+typedef struct {
+    float               v0x[TRI3_GROUP_SIZE], v0y[TRI3_GROUP_SIZE], v0z[TRI3_GROUP_SIZE];
+    float               e1x[TRI3_GROUP_SIZE], e1y[TRI3_GROUP_SIZE], e1z[TRI3_GROUP_SIZE];  /* v1 - v0 */
+    float               e2x[TRI3_GROUP_SIZE], e2y[TRI3_GROUP_SIZE], e2z[TRI3_GROUP_SIZE];  /* v2 - v0 */
+    uint32_t            tri[TRI3_GROUP_SIZE];       /* triangle index, UINT32_MAX for unused lanes */
+} tri3_group_t;
+
+#define TRI3_GROUP_MASK_ALL     ((uint32_t)((1ull << TRI3_GROUP_SIZE) - 1))
+
+static INLINE uint32_t      tri3_group_count(uint32_t tri_count)   { return (tri_count + TRI3_GROUP_SIZE - 1) / TRI3_GROUP_SIZE; }
+
+/**
+ @brief transpose triangles of a mesh into groups
+ @param groups [out] tri3_group_count(count) groups
+ @param tris the triangle indices to pack, NULL to pack triangles 0 .. count - 1
+ @return the number of groups written
+*/
+DLL_3DMATH_PUBLIC uint32_t          tri3_group_build(tri3_group_t* groups, tri3_mesh_t mesh, const uint32_t* tris, uint32_t count);
+
+/**
+ @brief nearest hit of a ray against the enabled lanes of a triangle group
+ @param lane_mask the lanes to test, bit i enables lane i
+ @param tmax only hits in [0, tmax) are reported
+ @param hit [out] nearest hit (t, barycentrics and triangle index)
+ @return true if a lane is hit
+*/
+DLL_3DMATH_PUBLIC bool              ray3_tri3_group_intersection(ray3_t r, const tri3_group_t* g, uint32_t lane_mask, float tmax, tri3_hit_t* hit);
+
+/*******************************************************************************
+**
+** swept sphere
+**
+** Continuous collision of a sphere moving along center + t * motion, t in
+** [0, 1], against triangle groups. Triangles are double sided. Lanes whose
+** bounds miss the swept box, or whose plane the sphere does not reach, are
+** rejected in the vectorized pass; only lanes where the plane contact point
+** falls outside the triangle go through the scalar edge and vertex tests.
+*******************************************************************************/
+typedef struct {
+    float               t;          /* time of impact, fraction of the motion */
+    vec3_t              point;      /* contact point on the triangle */
+    vec3_t              normal;     /* unit normal from the contact point to the sphere center */
+    uint32_t            tri;        /* triangle index */
+} sphere_sweep_hit_t;
+
+/**
+ @brief earliest contact of a moving sphere with the enabled lanes of a triangle group
+ @param tmax only contacts at t <= tmax are reported
+ @return true if a lane is hit, a sphere already touching a triangle hits at t = 0
+*/
+DLL_3DMATH_PUBLIC bool              sphere_sweep_tri3_group(vec3_t center, float radius, vec3_t motion, const tri3_group_t* g, uint32_t lane_mask, float tmax, sphere_sweep_hit_t* hit);
+
+/**
+ @brief earliest contact of a moving sphere with an array of triangle groups
+ @return true if a triangle is hit within the motion
+*/
+DLL_3DMATH_PUBLIC bool              sphere_sweep_tri3_groups(vec3_t center, float radius, vec3_t motion, const tri3_group_t* groups, uint32_t group_count, sphere_sweep_hit_t* hit);
+
+/*******************************************************************************
+**
+** bounding volume hierarchy
+**
+*******************************************************************************/
+/*
+** Nodes are stored flat, the two children of an inner node are adjacent
+** (first, first + 1). A leaf references count entries of prim_indices
+** starting at first.
+*/
+typedef struct {
+    box3_t              bounds;
+    uint32_t            first;      /* first child (inner node) or first primitive (leaf) */
+    uint32_t            count;      /* primitive count, 0 for inner nodes */
+} bvh_node_t;
+
+typedef struct {
+    bvh_node_t*         nodes;
+    uint32_t            node_count;
+    uint32_t*           prim_indices;
+    uint32_t            prim_count;
+    tri3_mesh_t         mesh;       /* only set by bvh_build_tri3 */
+    tri3_group_t*       groups;     /* mesh triangles in prim_indices order, TRI3_GROUP_SIZE per group */
+    uint32_t            group_count;
+    uint32_t            max_leaf_size;
+
+    /* refit state, allocated by the first bvh_refit */
+    float*              sah_cost;   /* per node SAH cost of the subtree */
+    float*              sah_ref;    /* per node SAH cost of the subtree over its root surface area when it was (re)built */
+    uint32_t*           levels;     /* reachable nodes in breadth first order */
+    uint32_t*           level_start;/* level_count + 1 offsets into levels */
+    uint32_t            level_count;
+} bvh_t;
+
+/**
+ @brief build a BVH over primitive bounds with a binned SAH
+ @param bvh [out] the hierarchy, release it with bvh_release
+ @param prim_bounds the bounds of each primitive
+ @param count primitive count
+ @param max_leaf_size maximum number of primitives in a leaf
+ @return false on allocation failure or empty input
+ @note large builds run in parallel when compiled with OpenMP
+*/
+DLL_3DMATH_PUBLIC bool              bvh_build(bvh_t* bvh, const box3_t* prim_bounds, uint32_t count, uint32_t max_leaf_size);
+
+/**
+ @brief build a BVH over the triangles of a mesh with a binned SAH
+*/
+DLL_3DMATH_PUBLIC bool              bvh_build_tri3(bvh_t* bvh, tri3_mesh_t mesh, uint32_t max_leaf_size);
+
+DLL_3DMATH_PUBLIC void              bvh_release(bvh_t* bvh);
+
+/**
+ @name linear BVH
+ Fast per frame rebuilds: primitive centroids are quantized in the scene box to
+ 30 bit Morton codes, radix sorted, and the hierarchy is emitted by splitting
+ Morton ranges at their highest differing bit (T. Karras, Maximizing Parallelism
+ in the Construction of BVHs, Octrees, and k-d Trees, 2012). Lower tree quality
+ than the SAH build, much faster to construct.
+ @{
+*/
+/** @brief 30 bit Morton code of a point quantized to a 1024^3 grid inside scene */
+DLL_3DMATH_PUBLIC uint32_t          morton3(vec3_t p, box3_t scene);
+DLL_3DMATH_PUBLIC void              morton3_array(const vec3_t* points, uint32_t count, box3_t scene, uint32_t* codes);
+
+/**
+ @brief LSD radix sort of keys, values (optional) are permuted along
+ @return false on allocation failure
+*/
+DLL_3DMATH_PUBLIC bool              radix_sort_u32(uint32_t* keys, uint32_t* values, uint32_t count);
+
+DLL_3DMATH_PUBLIC bool              bvh_build_lbvh(bvh_t* bvh, const box3_t* prim_bounds, uint32_t count, uint32_t max_leaf_size);
+DLL_3DMATH_PUBLIC bool              bvh_build_lbvh_tri3(bvh_t* bvh, tri3_mesh_t mesh, uint32_t max_leaf_size);
+/* @} */
+
+/**
+ @name refit
+ For deforming geometry with a fixed topology. A refit recomputes the node
+ bounds bottom up, one depth level at a time with each level in parallel, and
+ tracks the SAH cost of every subtree. Subtrees whose cost, relative to their
+ root surface area, grew past a factor of that cost when built are rebuilt in
+ place with the binned SAH.
+ @{
+*/
+/** @brief refit the node bounds to new primitive bounds (same primitive count and order) */
+DLL_3DMATH_PUBLIC bool              bvh_refit(bvh_t* bvh, const box3_t* prim_bounds);
+
+/** @brief refit a triangle BVH after its vertices moved, vertices replaces the mesh vertex array unless NULL */
+DLL_3DMATH_PUBLIC bool              bvh_refit_tri3(bvh_t* bvh, const vec3_t* vertices);
+
+/** @brief SAH cost of the hierarchy (expected traversal + intersection cost of a random ray hitting the root) */
+DLL_3DMATH_PUBLIC float             bvh_sah_cost(const bvh_t* bvh);
+
+/**
+ @brief rebuild the topmost subtrees whose SAH cost grew by more than max_growth since they were built
+ @param max_growth factor on the subtree cost over its root surface area (as bvh_sah_cost), uniform growth of the geometry does not count
+ @return the number of rebuilt subtrees
+ @note only meaningful after bvh_refit, a never refit hierarchy has no degraded subtree
+*/
+DLL_3DMATH_PUBLIC uint32_t          bvh_rebuild_degraded(bvh_t* bvh, const box3_t* prim_bounds, float max_growth);
+DLL_3DMATH_PUBLIC uint32_t          bvh_rebuild_degraded_tri3(bvh_t* bvh, float max_growth);
+/* @} */
+
+/**
+ @brief closest ray hit against a triangle BVH
+ @param tmax maximum parametric distance
+ @param hit [out] the closest hit
+ @return true if a triangle is hit within [0, tmax]
+*/
+DLL_3DMATH_PUBLIC bool              bvh_ray3_closest(const bvh_t* bvh, ray3_t r, float tmax, tri3_hit_t* hit);
+
+/**
+ @brief any ray hit against a triangle BVH (shadow/occlusion rays)
+ @return true if any triangle is hit within [0, tmax]
+*/
+DLL_3DMATH_PUBLIC bool              bvh_ray3_any(const bvh_t* bvh, ray3_t r, float tmax);
+
+/** @name closest point on a triangle BVH
+ Nearest first traversal, subtrees farther than the closest triangle found so far
+ (by box distance) are skipped.
+ @{
+*/
+typedef struct {
+    vec3_t              point;
+    float               u, v;       /* barycentrics of point with respect to v1 and v2 */
+    float               distance;
+    uint32_t            tri;        /* triangle index in the mesh */
+} tri3_closest_t;
+
+/**
+ @brief closest point of the mesh surface to pt
+ @param max_distance only triangles closer than max_distance are considered
+ @param out [out] the closest point
+ @return true if a triangle is within max_distance
+*/
+DLL_3DMATH_PUBLIC bool              bvh_closest_point(const bvh_t* bvh, vec3_t pt, float max_distance, tri3_closest_t* out);
+
+/**
+ @brief closest points of a batch of query points, spread across threads
+ @param found [out] per point flag (optional), out[i] is undefined for points with no triangle within max_distance
+ @return the number of points with a triangle within max_distance
+*/
+DLL_3DMATH_PUBLIC uint32_t          bvh_closest_point_array(const bvh_t* bvh, const vec3_t* pts, uint32_t count, float max_distance, tri3_closest_t* out, bool* found);
+/* @} */
+
+/*******************************************************************************
+**
+** loose octree
+**
+** Dynamic spatial index over box3_t items. An item lives in the deepest node
+** whose loose bounds (the cell grown by the looseness factor around its center)
+** contain it. Leaves split once they hold more than split_threshold items and
+** collapse back when their subtree empties. Nodes (in blocks of 8 siblings) and
+** items come from pools that only grow when exhausted, so steady state insert,
+** remove and move do not allocate. Items outside the world box stay in the
+** root, they are still found but every query tests them.
+*******************************************************************************/
+#define OCTREE_NONE         UINT32_MAX
+#define OCTREE_MAX_DEPTH    16
+
+typedef struct {
+    box3_t              bounds;     /* cell bounds */
+    box3_t              loose;      /* loose cell bounds */
+    uint32_t            parent;
+    uint32_t            children;   /* first of 8 consecutive children (box3_subdivide order), OCTREE_NONE for leaves */
+    uint32_t            items;      /* head of the item list of this node */
+    uint32_t            item_count; /* items in this node */
+    uint32_t            total_count;/* items in this node's subtree */
+    uint32_t            depth;
+} octree_node_t;
+
+typedef struct {
+    box3_t              bounds;
+    uint32_t            node;       /* owning node, OCTREE_NONE for free items */
+    uint32_t            prev, next;
+    uint32_t            user;
+} octree_item_t;
+
+typedef struct {
+    octree_node_t*      nodes;
+    uint32_t            node_count;     /* used slots (root + blocks of 8) */
+    uint32_t            node_capacity;
+    uint32_t            free_blocks;    /* free list of child blocks */
+    octree_item_t*      items;
+    uint32_t            item_count;     /* used slots */
+    uint32_t            item_capacity;
+    uint32_t            free_items;     /* free list of items */
+    float               looseness;
+    uint32_t            max_depth;
+    uint32_t            split_threshold;
+} octree_t;
+
+/**
+ @brief initialize an octree over a world box
+ @param looseness loose bounds scale (> 1, 2 is the usual choice)
+ @param max_depth maximum depth, clamped to OCTREE_MAX_DEPTH
+ @param split_threshold a leaf splits when it holds more items than this
+ @param capacity initial item capacity
+ @return false on allocation failure
+*/
+DLL_3DMATH_PUBLIC bool              octree_init(octree_t* o, box3_t world, float looseness, uint32_t max_depth, uint32_t split_threshold, uint32_t capacity);
+DLL_3DMATH_PUBLIC void              octree_release(octree_t* o);
+
+/**
+ @brief insert an item
+ @param user value reported by the queries
+ @return the item handle, OCTREE_NONE on allocation failure
+*/
+DLL_3DMATH_PUBLIC uint32_t          octree_insert(octree_t* o, box3_t bounds, uint32_t user);
+DLL_3DMATH_PUBLIC void              octree_remove(octree_t* o, uint32_t item);
+
+/** @brief update the bounds of an item, the handle stays valid */
+DLL_3DMATH_PUBLIC void              octree_move(octree_t* o, uint32_t item, box3_t bounds);
+
+/**
+ @name octree queries
+ Each query writes the user values of up to max_out overlapping items to out and
+ returns the total number of overlapping items.
+ @{
+*/
+DLL_3DMATH_PUBLIC uint32_t          octree_query_box3(const octree_t* o, box3_t b, uint32_t* out, uint32_t max_out);
+DLL_3DMATH_PUBLIC uint32_t          octree_query_sphere(const octree_t* o, vec3_t center, float radius, uint32_t* out, uint32_t max_out);
+DLL_3DMATH_PUBLIC uint32_t          octree_query_ray3(const octree_t* o, ray3_t r, float tmax, uint32_t* out, uint32_t max_out);
+/* @} */
+
+/*******************************************************************************
+**
+** spatial hash grid
+**
+** Points quantized into cubic cells of side cell_size, the cells are hashed into
+** a fixed size bucket table. Rebuilt in bulk from a position array with a
+** counting sort on the bucket, so a rebuild never allocates per point.
+*******************************************************************************/
+typedef struct {
+    float               cell_size;
+    float               inv_cell_size;
+    uint32_t            table_size;     /* bucket count, a power of two */
+    uint32_t*           bucket_start;   /* table_size + 1 offsets into the sorted arrays */
+    uint32_t*           indices;        /* original point index, sorted by bucket */
+    vec3_t*             positions;      /* point positions, sorted by bucket */
+    ivec3_t*            cells;          /* point cells, sorted by bucket */
+    uint32_t*           keys;           /* scratch: bucket of each input point */
+    uint32_t            count;
+    uint32_t            capacity;
+} hash_grid_t;
+
+static INLINE
+ivec3_t
+hash_grid_cell(const hash_grid_t* g, vec3_t p) {
+    return ivec3((int)floorf(p.x * g->inv_cell_size),
+                 (int)floorf(p.y * g->inv_cell_size),
+                 (int)floorf(p.z * g->inv_cell_size));
+}
+
+static INLINE
+uint32_t
+hash_grid_bucket(const hash_grid_t* g, ivec3_t c) {
+    // M. Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+    uint32_t    h   = ((uint32_t)c.x * 73856093u) ^ ((uint32_t)c.y * 19349663u) ^ ((uint32_t)c.z * 83492791u);
+    return h & (g->table_size - 1);
+}
+
+/**
+ @brief initialize an empty grid
+ @param cell_size cell side, ideally close to the typical query radius
+ @param table_size bucket count, rounded up to a power of two
+ @param capacity initial point capacity
+*/
+DLL_3DMATH_PUBLIC bool              hash_grid_init(hash_grid_t* g, float cell_size, uint32_t table_size, uint32_t capacity);
+DLL_3DMATH_PUBLIC void              hash_grid_release(hash_grid_t* g);
+
+/** @brief rebuild the grid from scratch, only reallocates when count exceeds the capacity */
+DLL_3DMATH_PUBLIC bool              hash_grid_build(hash_grid_t* g, const vec3_t* positions, uint32_t count);
+
+/**
+ @brief points within radius of center
+ @param out [out] up to max_out original point indices
+ @return the total number of points within radius
+*/
+DLL_3DMATH_PUBLIC uint32_t          hash_grid_query_sphere(const hash_grid_t* g, vec3_t center, float radius, uint32_t* out, uint32_t max_out);
+
+/**
+ @brief all the point pairs closer than radius
+ @param pairs [out] up to max_pairs pairs of original point indices (2 entries per pair)
+ @return the total number of pairs
+ @note runs in parallel over the points when compiled with OpenMP, the pair order is then unspecified
+*/
+DLL_3DMATH_PUBLIC uint32_t          hash_grid_pairs(const hash_grid_t* g, float radius, uint32_t* pairs, uint32_t max_pairs);
+
+/*******************************************************************************
+**
+** sort and sweep broadphase
+**
+** Boxes are kept sorted by their min along one axis, the one along which the
+** box centers spread the most. Between frames the order is repaired with an
+** insertion sort, which is close to linear when the boxes move coherently.
+** The sweep then only tests the boxes whose projections on the axis overlap. Endpoints carry a copy of the box so the sweep reads
+** memory sequentially.
+*******************************************************************************/
+typedef struct {
+    float               min, max;   /* box extent along the sweep axis */
+    vec2_t              omin, omax; /* box extent along the two other axes */
+    uint32_t            box;
+} sap_endpoint_t;
+
+typedef struct {
+    sap_endpoint_t*     endpoints;  /* sorted by min */
+    uint32_t            count;
+    uint32_t            capacity;
+    uint32_t            axis;       /* sweep axis, 0: x, 1: y, 2: z */
+} sap_t;
+
+/**
+ @brief initialize an empty broadphase
+ @param axis initial sweep axis, sap_update switches to the axis with the largest spread of box centers
+*/
+DLL_3DMATH_PUBLIC bool              sap_init(sap_t* s, uint32_t axis, uint32_t capacity);
+DLL_3DMATH_PUBLIC void              sap_release(sap_t* s);
+
+/**
+ @brief refresh the sorted endpoints from the current boxes
+ @note the box order must be stable across frames, a changed count or sweep axis triggers a full sort
+*/
+DLL_3DMATH_PUBLIC bool              sap_update(sap_t* s, const box3_t* boxes, uint32_t count);
+
+/**
+ @brief overlapping box pairs (as of the last sap_update)
+ @param pairs [out] up to max_pairs pairs of box indices (2 entries per pair)
+ @return the total number of overlapping pairs
+ @note runs in parallel when compiled with OpenMP, the pair order is then unspecified
+*/
+DLL_3DMATH_PUBLIC uint32_t          sap_pairs(const sap_t* s, uint32_t* pairs, uint32_t max_pairs);
+
+/*******************************************************************************
+**
+** ray packets
+**
+** Coherent rays are stored in SoA form so each operation runs over all the
+** lanes at once (the lane loops are written to be auto-vectorized). Lanes are
+** enabled through a bit mask, bit i set means lane i is active.
+*******************************************************************************/
+#ifndef RAY3_PACKET_SIZE
+#   define RAY3_PACKET_SIZE     8   /* 4 or 8 */
+#endif
+
+typedef struct {
+    float               ox[RAY3_PACKET_SIZE], oy[RAY3_PACKET_SIZE], oz[RAY3_PACKET_SIZE];  /* origins */
+    float               dx[RAY3_PACKET_SIZE], dy[RAY3_PACKET_SIZE], dz[RAY3_PACKET_SIZE];  /* directions */
+    float               ix[RAY3_PACKET_SIZE], iy[RAY3_PACKET_SIZE], iz[RAY3_PACKET_SIZE];  /* reciprocal directions */
+    float               tmax[RAY3_PACKET_SIZE];     /* per lane maximum distance, shrinks as closer hits are found */
+} ray3_packet_t;
+
+#define RAY3_PACKET_MASK_ALL    ((uint32_t)((1ull << RAY3_PACKET_SIZE) - 1))
+
+/**
+ @brief load up to RAY3_PACKET_SIZE rays into a packet
+ @return the active lane mask (one bit per loaded ray)
+*/
+DLL_3DMATH_PUBLIC uint32_t          ray3_packet(ray3_packet_t* p, const ray3_t* rays, uint32_t count, float tmax);
+
+static INLINE ray3_t                ray3_packet_lane(const ray3_packet_t* p, uint32_t lane)  { return ray3_from(vec3(p->ox[lane], p->oy[lane], p->oz[lane]), vec3(p->dx[lane], p->dy[lane], p->dz[lane])); }
+
+/**
+ @brief slab test of the active lanes against a box, restricted to [0, tmax] of each lane
+ @param tmin [out] per lane entry distance (optional)
+ @return the mask of the active lanes that hit the box
+*/
+DLL_3DMATH_PUBLIC uint32_t          intersect_box3_ray3_packet(box3_t b, const ray3_packet_t* p, uint32_t mask, float* tmin);
+
+/**
+ @brief Moller-Trumbore test of the active lanes against a triangle
+ @param tri triangle index stored in the hit records
+ @param hits [in/out] per lane hit records, updated for lanes that hit closer than their tmax
+ @return the mask of the lanes that hit, their tmax is set to the hit distance
+*/
+DLL_3DMATH_PUBLIC uint32_t          ray3_packet_tri3_intersection(ray3_packet_t* p, uint32_t mask, vec3_t v0, vec3_t v1, vec3_t v2, uint32_t tri, tri3_hit_t* hits);
+
+/**
+ @brief closest hits of a ray packet against a triangle BVH, each node is fetched once for all lanes
+ @param hits [out] RAY3_PACKET_SIZE hit records
+ @return the mask of the lanes that hit
+*/
+DLL_3DMATH_PUBLIC uint32_t          bvh_ray3_packet_closest(const bvh_t* bvh, ray3_packet_t* p, uint32_t mask, tri3_hit_t* hits);
+
+/**
+ @brief any hit of a ray packet against a triangle BVH (shadow rays)
+ @return the mask of the occluded lanes
+*/
+DLL_3DMATH_PUBLIC uint32_t          bvh_ray3_packet_any(const bvh_t* bvh, ray3_packet_t* p, uint32_t mask);
+
+/*******************************************************************************
+**
+** signed distance fields
+**
+** Distances are sampled at the nodes of a regular grid spanning the domain,
+** negative inside the mesh. Baking computes exact distances in a narrow band
+** around the surface, then propagates the closest triangles to the remaining
+** nodes by fast sweeping. The sign is the majority vote of the crossing
+** parities along the three axes, which tolerates small holes in the mesh.
+*******************************************************************************/
+typedef struct {
+    box3_t              domain;
+    ivec3_t             dims;       /* samples per axis, at least 2 */
+    vec3_t              cell;       /* sample spacing */
+    vec3_t              inv_cell;
+    float*              distance;   /* dims.x * dims.y * dims.z samples, x fastest */
+} sdf_t;
+
+/**
+ @brief bake the signed distance field of a closed triangle mesh
+ @param dims samples per axis, at least 2
+ @param band width of the exactly computed band around the surface, in cells
+ @return false on empty input or allocation failure
+*/
+DLL_3DMATH_PUBLIC bool              sdf_bake(sdf_t* sdf, tri3_mesh_t mesh, box3_t domain, ivec3_t dims, uint32_t band);
+DLL_3DMATH_PUBLIC void              sdf_release(sdf_t* sdf);
+
+/** @brief trilinear sample, points outside the domain are clamped to it */
+DLL_3DMATH_PUBLIC float             sdf_sample(const sdf_t* sdf, vec3_t p);
+
+/** @brief gradient of the trilinear interpolant (not normalized) */
+DLL_3DMATH_PUBLIC vec3_t            sdf_gradient(const sdf_t* sdf, vec3_t p);
+
+/*******************************************************************************
+**
+** voxelization
+**
+** Bit packed occupancy of the cells of a regular grid spanning the domain.
+** Triangles are processed in parallel, each one only visits the cells under
+** its bounds. Voxelizing several meshes into the same grid accumulates them.
+*******************************************************************************/
+typedef enum {
+    VOXELIZE_CONSERVATIVE,      /* every cell a triangle touches (exact triangle/box test) */
+    VOXELIZE_SURFACE            /* thin surface: cells whose axis aligned center lines a triangle crosses */
+} voxelize_mode_t;
+
+typedef struct {
+    box3_t              domain;
+    ivec3_t             dims;       /* cells per axis */
+    vec3_t              cell;       /* cell size */
+    uint64_t*           bits;       /* one bit per cell, x fastest */
+    uint32_t            word_count;
+} voxel_grid_t;
+
+DLL_3DMATH_PUBLIC bool              voxel_grid_init(voxel_grid_t* g, box3_t domain, ivec3_t dims);
+DLL_3DMATH_PUBLIC void              voxel_grid_release(voxel_grid_t* g);
+DLL_3DMATH_PUBLIC void              voxel_grid_clear(voxel_grid_t* g);
+
+static INLINE uint32_t              voxel_grid_index(const voxel_grid_t* g, int x, int y, int z)    { return ((uint32_t)z * (uint32_t)g->dims.y + (uint32_t)y) * (uint32_t)g->dims.x + (uint32_t)x; }
+static INLINE bool                  voxel_grid_get(const voxel_grid_t* g, int x, int y, int z)      { uint32_t i = voxel_grid_index(g, x, y, z); return (g->bits[i >> 6] >> (i & 63)) & 1; }
+
+/** @brief mark the cells occupied by the triangles of a mesh */
+DLL_3DMATH_PUBLIC void              voxelize_tri3(voxel_grid_t* g, tri3_mesh_t mesh, voxelize_mode_t mode);
+
+/** @brief number of occupied cells */
+DLL_3DMATH_PUBLIC uint32_t          voxel_grid_count(const voxel_grid_t* g);
+
+/*******************************************************************************
+**
+** convex narrowphase
+**
+** GJK distance and EPA penetration between convex shapes given by support
+** functions (the farthest point of the shape in a direction). Spheres and
+** capsules are a point or a segment core with a radius: GJK runs on the cores
+** and the radii are applied afterwards, so only cores that overlap need EPA.
+** A gjk_cache_t kept per pair across frames stores the directions of the
+** final simplex, the next query starts from the supports in those directions.
+*******************************************************************************/
+typedef struct convex3_s convex3_t;
+
+struct convex3_s {
+    vec3_t              (*support)(const convex3_t* c, vec3_t dir);
+    const void*         data;
+    uint32_t            count;      /* point count of point sets */
+    float               radius;     /* rounding radius around the core */
+};
+
+DLL_3DMATH_PUBLIC vec3_t            convex3_support_point(const convex3_t* c, vec3_t dir);
+DLL_3DMATH_PUBLIC vec3_t            convex3_support_segment3(const convex3_t* c, vec3_t dir);
+DLL_3DMATH_PUBLIC vec3_t            convex3_support_box3(const convex3_t* c, vec3_t dir);
+DLL_3DMATH_PUBLIC vec3_t            convex3_support_obb3(const convex3_t* c, vec3_t dir);
+DLL_3DMATH_PUBLIC vec3_t            convex3_support_points(const convex3_t* c, vec3_t dir);
+
+static INLINE convex3_t             convex3(vec3_t (*support)(const convex3_t*, vec3_t), const void* data, uint32_t count, float radius)  { convex3_t c; c.support = support; c.data = data; c.count = count; c.radius = radius; return c; }
+
+/* the shapes are referenced, not copied */
+static INLINE convex3_t             convex3_sphere(const sphere_t* s)                       { return convex3(convex3_support_point, &s->center, 1, s->radius);     }
+static INLINE convex3_t             convex3_capsule(const capsule_t* c)                     { return convex3(convex3_support_segment3, &c->axis, 2, c->radius);    }
+static INLINE convex3_t             convex3_box3(const box3_t* b)                           { return convex3(convex3_support_box3, b, 8, 0.0f);                    }
+static INLINE convex3_t             convex3_obb3(const obb3_t* o)                           { return convex3(convex3_support_obb3, o, 8, 0.0f);                    }
+static INLINE convex3_t             convex3_points(const vec3_t* points, uint32_t count)    { return convex3(convex3_support_points, points, count, 0.0f);        }
+
+typedef struct {
+    vec3_t              dirs[4];    /* support directions of the last simplex, for shape a */
+    uint32_t            count;      /* 0 for a cold start */
+} gjk_cache_t;
+
+typedef struct {
+    vec3_t              point_a;    /* closest (or deepest) point on a */
+    vec3_t              point_b;    /* closest (or deepest) point on b */
+    vec3_t              normal;     /* unit, from a toward b */
+    float               distance;   /* separation, negative for penetration */
+    uint32_t            iterations; /* GJK plus EPA iterations */
+} convex3_contact_t;
+
+/**
+ @brief GJK distance between two convex shapes
+ @param cache warm start in, final simplex out (optional)
+ @param out [out] separation, normal and closest points; only the overlap is known when the cores intersect
+ @return true if the shapes are separated
+*/
+DLL_3DMATH_PUBLIC bool              gjk_distance(const convex3_t* a, const convex3_t* b, gjk_cache_t* cache, convex3_contact_t* out);
+
+/**
+ @brief GJK distance, followed by EPA when the cores intersect
+ @param cache warm start in, final GJK simplex out (optional)
+ @param out [out] signed distance, normal and witness points
+ @return true if the shapes overlap
+*/
+DLL_3DMATH_PUBLIC bool              gjk_epa(const convex3_t* a, const convex3_t* b, gjk_cache_t* cache, convex3_contact_t* out);
+
+/*******************************************************************************
+**
+** convex hull
+**
+** Quickhull over a point set. Faces are convex polygons: triangles whose
+** vertices lie within the tolerance of a common plane are merged, and
+** vertices in the middle of a polygon edge are dropped. With a vertex cap
+** the point furthest out of the current hull is added first, the capped
+** hull is then an inner approximation of the points.
+*******************************************************************************/
+typedef struct {
+    vec3_t*             vertices;
+    uint32_t            vertex_count;
+    uint32_t*           indices;        /* polygon vertices, counter clockwise seen from outside */
+    uint32_t            index_count;
+    uint32_t*           face_first;     /* face i spans indices [face_first[i], face_first[i + 1]) */
+    plane_t*            planes;         /* unit outward planes, n.p + d > 0 outside */
+    uint32_t            face_count;
+} convex_hull_t;
+
+/**
+ @brief build the convex hull of a point set
+ @param max_vertices vertex cap, 0 for none
+ @param tolerance coplanarity distance, raised to the float precision of the input coordinates
+ @return false on flat input, fewer than 4 points or allocation failure
+*/
+DLL_3DMATH_PUBLIC bool              convex_hull_build(convex_hull_t* h, const vec3_t* points, uint32_t count, uint32_t max_vertices, float tolerance);
+DLL_3DMATH_PUBLIC void              convex_hull_release(convex_hull_t* h);
+
+/** @brief true if the point is at most margin in front of every face plane */
+DLL_3DMATH_PUBLIC bool              convex_hull_contains(const convex_hull_t* h, vec3_t p, float margin);
+
+/** @brief batched containment, returns the number of points inside */
+DLL_3DMATH_PUBLIC uint32_t          convex_hull_contains_array(const convex_hull_t* h, const vec3_t* points, uint32_t count, float margin, bool* inside);
+
+/* support mapping of the hull vertices for gjk_distance / gjk_epa, the hull is referenced */
+static INLINE convex3_t             convex3_hull(const convex_hull_t* h)                    { return convex3(convex3_support_points, h->vertices, h->vertex_count, 0.0f); }
+
+/*******************************************************************************
+**
+** bounding volume fitting
+**
+** Reductions over large point arrays: chunks of the array are reduced in
+** parallel with branch free lane loops, then folded in a fixed order, so the
+** results do not depend on the thread count. Moments accumulate in double.
+*******************************************************************************/
+/** @brief bounds of a point array, box3_empty() when count is 0 */
+DLL_3DMATH_PUBLIC box3_t            box3_from_points(const vec3_t* points, uint32_t count);
+
+DLL_3DMATH_PUBLIC vec3_t            points_centroid(const vec3_t* points, uint32_t count);
+
+/**
+ @brief covariance matrix of a point array
+ @param centroid [out] the mean of the points (optional)
+*/
+DLL_3DMATH_PUBLIC mat3_t            points_covariance(const vec3_t* points, uint32_t count, vec3_t* centroid);
+
+/**
+ @brief eigen decomposition of a symmetric matrix
+ @param values [out] eigenvalues in decreasing order
+ @param vectors [out] unit eigenvectors in the columns, same order
+*/
+DLL_3DMATH_PUBLIC void              mat3_symmetric_eigen(mat3_t m, vec3_t* values, mat3_t* vectors);
+
+/** @brief near minimal bounding sphere: Ritter's sphere from extreme points, refined by shrinking and regrowing */
+DLL_3DMATH_PUBLIC sphere_t          sphere_from_points(const vec3_t* points, uint32_t count);
+
+/** @brief oriented box along the principal axes of the points, or the axis aligned box when it is smaller */
+DLL_3DMATH_PUBLIC obb3_t            obb3_from_points(const vec3_t* points, uint32_t count);
+
+/*******************************************************************************
+**
+** plane classification and clipping
+**
+** Distances are n.p + d, metric for unit planes (see plane_normalize).
+** Clipping keeps the part behind the plane (n.p + d <= 0), the inside of a
+** set of outward planes such as the faces of a convex_hull_t. Vertices within
+** epsilon of a plane count as on it. Every output goes to caller buffers:
+** clipping a convex polygon by k planes adds at most k vertices.
+*******************************************************************************/
+typedef enum {
+    PLANE_FRONT     = 1,
+    PLANE_BACK      = 2,
+    PLANE_ON        = 4
+} plane_side_t;
+
+/** @brief signed distances of the points */
+DLL_3DMATH_PUBLIC void              plane_distance_array(plane_t p, const vec3_t* points, uint32_t count, float* out);
+
+/**
+ @brief classify the points against a plane
+ @param sides [out] a plane_side_t per point (optional)
+ @return the union of the sides found, PLANE_FRONT | PLANE_BACK for a straddling set
+*/
+DLL_3DMATH_PUBLIC uint32_t          plane_classify_array(plane_t p, const vec3_t* points, uint32_t count, float epsilon, uint8_t* sides);
+
+/**
+ @brief clip a convex polygon against a plane
+ @param out [out] count + 1 vertices
+ @return the vertex count of the part behind the plane, 0 when nothing is left
+*/
+DLL_3DMATH_PUBLIC uint32_t          clip_polygon_plane(const vec3_t* in, uint32_t count, plane_t p, float epsilon, vec3_t* out);
+
+/**
+ @brief clip a convex polygon against a convex set of planes
+ @param out [out] count + plane_count vertices
+ @param scratch same capacity as out
+*/
+DLL_3DMATH_PUBLIC uint32_t          clip_polygon_planes(const vec3_t* in, uint32_t count, const plane_t* planes, uint32_t plane_count, float epsilon, vec3_t* out, vec3_t* scratch);
+
+/**
+ @brief split a convex polygon in its front and back parts (BSP, CSG)
+ @param front [out] count + 1 vertices
+ @param back [out] count + 1 vertices
+ @return the union of the sides of the vertices, PLANE_ON alone for a polygon in the plane (copied to both sides)
+*/
+DLL_3DMATH_PUBLIC uint32_t          split_polygon_plane(const vec3_t* in, uint32_t count, plane_t p, float epsilon, vec3_t* front, uint32_t* front_count, vec3_t* back, uint32_t* back_count);
+
+/**
+ @brief clip a triangle list (3 vertices per triangle), clipped polygons are fanned back into triangles
+ @param out [out] tri_count * (plane_count + 1) triangles
+ @return the output triangle count, 0 also on allocation failure of the per call scratch
+*/
+DLL_3DMATH_PUBLIC uint32_t          clip_tri3_list_planes(const vec3_t* tris, uint32_t tri_count, const plane_t* planes, uint32_t plane_count, float epsilon, vec3_t* out);
+
+/** @brief clip_tri3_list_planes with a single plane, out holds 2 * tri_count triangles */
+DLL_3DMATH_PUBLIC uint32_t          clip_tri3_list_plane(const vec3_t* tris, uint32_t tri_count, plane_t p, float epsilon, vec3_t* out);
+
+/*******************************************************************************
+**
+** clip space triangle pipeline
+**
+** Vertices are transformed once to homogeneous clip space (-w <= x, y, z <= w,
+** the OpenGL convention of mat4_perspective) and tagged with outcodes. A
+** triangle whose vertices share an outcode bit is rejected, one without bits
+** is only divided, and the remaining straddlers are clipped in homogeneous
+** space against the planes they cross. Screen positions use the mapping of
+** vec3_project: x and y from lb to rt, depth in [0, 1].
+*******************************************************************************/
+typedef enum {
+    OUTCODE_LEFT    = 1,
+    OUTCODE_RIGHT   = 2,
+    OUTCODE_BOTTOM  = 4,
+    OUTCODE_TOP     = 8,
+    OUTCODE_NEAR    = 16,
+    OUTCODE_FAR     = 32
+} outcode_t;
+
+/** @brief facing is counter clockwise front in normalized device coordinates */
+typedef enum {
+    CULL_NONE,
+    CULL_BACK,
+    CULL_FRONT
+} cull_mode_t;
+
+typedef struct {
+    vec3_t      v[3];       ///< screen x, y and depth
+    uint32_t    tri;        ///< source triangle
+} screen_tri_t;
+
+/** @brief transform points to homogeneous coordinates (M * (p, 1)) */
+DLL_3DMATH_PUBLIC void              transform_vec3_array(mat4_t m, const vec3_t* in, uint32_t count, vec4_t* out);
+
+/**
+ @brief outcodes of clip space vertices
+ @param codes [out] an outcode_t mask per vertex
+ @return the outcodes common to all vertices, non zero when the whole set is outside a plane
+*/
+DLL_3DMATH_PUBLIC uint32_t          clip_outcode_array(const vec4_t* in, uint32_t count, uint8_t* codes);
+
+/**
+ @brief clip, project and cull triangles to the screen, in triangle order
+ @param indices 3 per triangle, NULL for a triangle soup
+ @param out [out] up to capacity triangles, a triangle clipped by the 6 planes gives up to 7
+ @return the triangle count of the full output, more than capacity when truncated
+*/
+DLL_3DMATH_PUBLIC uint32_t          clip_tri4_to_screen(const vec4_t* clip, const uint8_t* codes, const uint32_t* indices, uint32_t tri_count, vec2_t lb, vec2_t rt, cull_mode_t cull, screen_tri_t* out, uint32_t capacity);
+
+/*******************************************************************************
+**
+** software rasterizer
+**
+** Half-space rasterization of pixel space triangles with exact fixed point
+** edge functions (1/16 pixel) and the top-left rule for y down targets, so
+** triangles sharing an edge never both cover a pixel center (x + 0.5,
+** y + 0.5). Both windings are drawn, culling belongs to clip_tri4_to_screen.
+** The target is split in tiles binned in submission order and rendered in
+** parallel, each tile by one thread: the result matches a serial pass and the
+** fragment hook needs no locking for its pixel.
+*******************************************************************************/
+typedef struct {
+    int         width, height;
+    float*      depth;      ///< width * height, fragments pass when nearer (less), NULL disables the test
+    uint32_t*   ids;        ///< width * height, receives the triangle index of passing fragments (optional)
+
+    /// depth test hook (optional), called after the depth buffer test with the
+    /// perspective correct barycentric coordinates, false discards the fragment
+    bool        (*fragment)(void* user, int x, int y, float depth, vec3_t bary, uint32_t tri);
+    void*       user;
+} raster_target_t;
+
+static INLINE raster_target_t       raster_target(int width, int height, float* depth, uint32_t* ids) { raster_target_t t = { width, height, depth, ids, 0, 0 }; return t; }
+
+/** @brief fill the depth and id buffers that are present */
+DLL_3DMATH_PUBLIC void              raster_clear(raster_target_t* t, float depth, uint32_t id);
+
+/**
+ @brief rasterize triangles, pixel coordinates with y down
+ @param points 3 per triangle, coordinates beyond 2^20 pixels skip the triangle (clip first)
+ @param depths 3 per triangle, interpolated linearly in screen space (NULL for 0)
+ @param inv_w 3 per triangle, 1 / clip w for perspective correct barycentrics (NULL for affine)
+ @return false when the per call setup and bins cannot be allocated
+*/
+DLL_3DMATH_PUBLIC bool              raster_tri2_array(raster_target_t* t, const vec2_t* points, const float* depths, const float* inv_w, uint32_t tri_count);
+
+/*******************************************************************************
+**
+** hierarchical depth occlusion culling
+**
+** A low resolution depth buffer of occluders over a cached view projection,
+** rasterized through clip_tri4_to_screen and raster_tri2_array, then reduced
+** to a max depth pyramid. Boxes test their screen rectangle and nearest
+** depth against the coarsest level covering it in a few texels. Occluders
+** are sampled at pixel centers as on the GPU. Once built, the buffer is only
+** read: tests are thread safe and can overlap other work of the frame.
+*******************************************************************************/
+#define OCCLUSION_MAX_LEVELS    16
+
+typedef struct {
+    int             width, height;
+    int             level_count;
+    ivec2_t         level_size[OCCLUSION_MAX_LEVELS];
+    float*          level[OCCLUSION_MAX_LEVELS];    ///< level 0 is the depth buffer (1 is far), rows down
+    mat4_t          view_proj;
+
+    // occluder scratch, grown on demand
+    vec4_t*         clip;
+    uint8_t*        codes;
+    uint32_t        vertex_capacity;
+    screen_tri_t*   tris;
+    vec2_t*         points;
+    float*          depths;
+    uint32_t        tri_capacity;
+} occlusion_buffer_t;
+
+DLL_3DMATH_PUBLIC bool              occlusion_buffer_init(occlusion_buffer_t* b, int width, int height);
+DLL_3DMATH_PUBLIC void              occlusion_buffer_release(occlusion_buffer_t* b);
+
+/** @brief clear the depth buffer and cache the view projection of the frame */
+DLL_3DMATH_PUBLIC void              occlusion_buffer_begin(occlusion_buffer_t* b, mat4_t view_proj);
+
+/**
+ @brief rasterize the front faces of an occluder mesh
+ @param indices 3 per triangle, NULL for a triangle soup
+ @return false on allocation failure
+*/
+DLL_3DMATH_PUBLIC bool              occlusion_buffer_add_occluder(occlusion_buffer_t* b, mat4_t world, const vec3_t* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t tri_count);
+
+/** @brief build the max depth pyramid, once all occluders are in */
+DLL_3DMATH_PUBLIC void              occlusion_buffer_build(occlusion_buffer_t* b);
+
+/** @brief false when a world box is hidden by the occluders or outside the view */
+DLL_3DMATH_PUBLIC bool              occlusion_buffer_test_box(const occlusion_buffer_t* b, box3_t box);
+
+/**
+ @brief occlusion_buffer_test_box over an array, in parallel
+ @return the visible count
+*/
+DLL_3DMATH_PUBLIC uint32_t          occlusion_buffer_test_box_array(const occlusion_buffer_t* b, const box3_t* boxes, uint32_t count, bool* visible);
+
+/*******************************************************************************
+**
+** mesh normals and tangents
+**
+** Bulk versions of tri3_normal over a tri3_mesh_t. Vertex sums are gathered
+** per vertex from its corners sorted by vertex, without atomics, so results
+** do not depend on the thread count. Degenerate faces and unreferenced
+** vertices get zero normals.
+*******************************************************************************/
+typedef enum {
+    NORMAL_WEIGHT_AREA,         ///< faces weighted by their area
+    NORMAL_WEIGHT_ANGLE         ///< faces weighted by their corner angle, independent of the tessellation
+} normal_weight_t;
+
+/**
+ @brief unit face normals (counter clockwise front) and areas
+ @param normals [out] one per triangle (optional)
+ @param areas [out] one per triangle (optional)
+*/
+DLL_3DMATH_PUBLIC void              tri3_mesh_face_normals(tri3_mesh_t mesh, vec3_t* normals, float* areas);
+
+/**
+ @brief smooth vertex normals
+ @param normals [out] vertex_count normals
+ @return false when the per call scratch cannot be allocated
+*/
+DLL_3DMATH_PUBLIC bool              tri3_mesh_vertex_normals(tri3_mesh_t mesh, uint32_t vertex_count, normal_weight_t weight, vec3_t* normals);
+
+/**
+ @brief MikkTSpace tangent frames per vertex
+ Face tangents follow MikkTSpace: texture derivatives oriented by the texture
+ area sign, projected on the tangent plane of the vertex normal, normalized
+ and weighted by the projected corner angle. The frame is per vertex, so
+ vertices shared by mirrored faces take the majority and should be split
+ at the texture seam beforehand, as MikkTSpace would.
+ @param normals vertex_count unit normals
+ @param uvs vertex_count texture coordinates
+ @param tangents [out] vertex_count tangents, w is the bitangent sign: b = w * cross(n, t)
+ @return false when the per call scratch cannot be allocated
+*/
+DLL_3DMATH_PUBLIC bool              tri3_mesh_tangents(tri3_mesh_t mesh, uint32_t vertex_count, const vec3_t* normals, const vec2_t* uvs, vec4_t* tangents);
+
+/*******************************************************************************
+**
+** vertex welding
+**
+** Duplicate vertices are found through a hash_grid_t with cells of a few
+** tolerances, scanning the cells each vertex's tolerance overlaps in parallel.
+** Welding is greedy in index order: a vertex joins the first earlier kept
+** vertex it matches, so kept vertices are never closer than the tolerance
+** and every vertex is within it of its kept vertex. Results do not depend on
+** the thread count.
+*******************************************************************************/
+/**
+ @brief weld vertices within a tolerance
+ @param normals optional, vertices also need normals within normal_epsilon
+ @param uvs optional, vertices also need texture coordinates within uv_epsilon
+ @param remap [out] count new indices, numbered in order of first occurrence
+ @param unique [out] optional, the source index of each new vertex (the returned count)
+ @return the new vertex count, 0 on allocation failure
+*/
+DLL_3DMATH_PUBLIC uint32_t          weld_vertices(const vec3_t* positions, const vec3_t* normals, const vec2_t* uvs, uint32_t count, float epsilon, float normal_epsilon, float uv_epsilon, uint32_t* remap, uint32_t* unique);
+
+/** @brief compact an attribute stream, out[i] = in[unique[i]] */
+DLL_3DMATH_PUBLIC void              weld_gather_vec3(const vec3_t* in, const uint32_t* unique, uint32_t unique_count, vec3_t* out);
+DLL_3DMATH_PUBLIC void              weld_gather_vec2(const vec2_t* in, const uint32_t* unique, uint32_t unique_count, vec2_t* out);
+
+/**
+ @brief remap triangle indices in place, dropping triangles that collapsed
+ @return the remaining triangle count
+*/
+DLL_3DMATH_PUBLIC uint32_t          weld_remap_triangles(uint32_t* indices, uint32_t tri_count, const uint32_t* remap);
+
+/*******************************************************************************
+**
+** mesh simplification
+**
+** Garland-Heckbert quadric error edge collapses from a priority queue. Each
+** vertex collapses onto a neighbour, so the output indexes the input vertices
+** and their attributes unchanged. Input vertices sharing a position are wedges
+** of an attribute seam (see weld_vertices): seam and non manifold vertices are
+** locked, border vertices only slide along the border, which also carries
+** constraint planes. Collapses that pinch the surface (link condition) or
+** flip a face are rejected.
+*******************************************************************************/
+/**
+ @brief simplify an indexed mesh
+ @param target_tri_count stop at or below this triangle count
+ @param target_error stop before a collapse with a larger error, the root mean square distance to the planes of the merged faces
+ @param out_indices [out] 3 per triangle, at most the input triangle count
+ @param out_error [out] the largest error of the collapses done (optional)
+ @return the output triangle count, 0 on allocation failure
+*/
+DLL_3DMATH_PUBLIC uint32_t          tri3_mesh_simplify(tri3_mesh_t mesh, uint32_t vertex_count, uint32_t target_tri_count, float target_error, uint32_t* out_indices, float* out_error);
+
+/*******************************************************************************
+**
+** skinning
+**
+** Linear blend skinning over vertex streams. The weighted palette matrices
+** of a vertex are blended once into an affine matrix, lanes of vertices are
+** blended and transformed together and blocks of lanes are split across
+** threads. Only the affine part (upper 3 rows) of the palette is read.
+*******************************************************************************/
+/**
+ @brief skin positions and optionally normals
+ @param palette skinning matrices, joint world transform times its inverse bind pose
+ @param joints influences palette indices per vertex
+ @param weights influences weights per vertex, summing to 1, zero weights are skipped
+ @param influences per vertex, typically 4 or 8
+ @param normals optional, transformed by the blended 3x3 part and renormalized (rigid or uniformly scaled joints)
+ @param out_normals optional, with normals
+*/
+DLL_3DMATH_PUBLIC void              skin_vertices(const mat4_t* palette, const uint16_t* joints, const float* weights, uint32_t influences, const vec3_t* positions, const vec3_t* normals, uint32_t count, vec3_t* out_positions, vec3_t* out_normals);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,291 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+/*
+** benchmark program, built with -DBUILD_BENCH=ON
+**
+**  3dmath_bench [bvh|sap|skin] [scale]
+**
+** runs every section without arguments, scale multiplies the problem sizes
+*/
+#include "3dmath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+static double   now(void)       { return omp_get_wtime(); }
+static int      threads(void)   { return omp_get_max_threads(); }
+#else
+#include <time.h>
+static double   now(void)       { return (double)clock() / CLOCKS_PER_SEC; }
+static int      threads(void)   { return 1; }
+#endif
+
+/* deterministic inputs, independent of the C library rand */
+static uint32_t rng_state   = 0x9e3779b9u;
+
+static
+float
+frand(void) {
+    rng_state   = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+/* torus of 2 * rings * sides triangles around the z axis */
+static
+void
+make_torus(uint32_t rings, uint32_t sides, vec3_t** vertices, uint32_t** indices, uint32_t* vertex_count, uint32_t* tri_count) {
+    uint32_t    vc  = rings * sides;
+    uint32_t    tc  = 2 * rings * sides;
+    vec3_t*     v   = (vec3_t*)malloc(sizeof(vec3_t) * vc);
+    uint32_t*   idx = (uint32_t*)malloc(sizeof(uint32_t) * 3 * tc);
+
+    for( uint32_t r = 0; r < rings; ++r ) {
+        for( uint32_t s = 0; s < sides; ++s ) {
+            float   a   = 2.0f * (float)M_PI * (float)s / (float)sides;
+            float   b   = 2.0f * (float)M_PI * (float)r / (float)rings;
+            v[r * sides + s]    = vec3((2.0f + 0.7f * cosf(b)) * cosf(a), (2.0f + 0.7f * cosf(b)) * sinf(a), 0.7f * sinf(b));
+        }
+    }
+
+    uint32_t*   t   = idx;
+    for( uint32_t r = 0; r < rings; ++r ) {
+        for( uint32_t s = 0; s < sides; ++s ) {
+            uint32_t    a   = r * sides + s;
+            uint32_t    b   = r * sides + (s + 1) % sides;
+            uint32_t    c   = ((r + 1) % rings) * sides + s;
+            uint32_t    d   = ((r + 1) % rings) * sides + (s + 1) % sides;
+            *t++ = a; *t++ = b; *t++ = c;
+            *t++ = b; *t++ = d; *t++ = c;
+        }
+    }
+
+    *vertices       = v;
+    *indices        = idx;
+    *vertex_count   = vc;
+    *tri_count      = tc;
+}
+
+/*******************************************************************************
+** bvh: binned SAH build time, closest and any hit rays per second
+*******************************************************************************/
+static
+void
+bench_bvh(float scale) {
+    vec3_t*     vertices;
+    uint32_t*   indices;
+    uint32_t    vertex_count, tri_count;
+    uint32_t    ray_count   = (uint32_t)(1000000 * scale);
+    ray3_t*     rays        = (ray3_t*)malloc(sizeof(ray3_t) * ray_count);
+    bvh_t       bvh;
+
+    make_torus((uint32_t)(500 * sqrtf(scale)), (uint32_t)(1000 * sqrtf(scale)), &vertices, &indices, &vertex_count, &tri_count);
+
+    // from a sphere around the torus towards points near its center
+    for( uint32_t i = 0; i < ray_count; ++i ) {
+        vec3_t  o   = vec3_mulf(vec3_normalize(vec3(frand() - 0.5f, frand() - 0.5f, frand() - 0.5f)), 6.0f);
+        vec3_t  d   = vec3(3.0f * (frand() - 0.5f), 3.0f * (frand() - 0.5f), frand() - 0.5f);
+        rays[i]     = ray3_from(o, vec3_normalize(vec3_sub(d, o)));
+    }
+
+    double  t0  = now();
+    if( !bvh_build_tri3(&bvh, tri3_mesh(vertices, indices, tri_count), 4) ) {
+        printf("bvh: build failed\n");
+        return;
+    }
+    double  t1  = now();
+
+    uint32_t    closest = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:closest)
+    for( int i = 0; i < (int)ray_count; ++i ) {
+        tri3_hit_t  hit;
+        closest += bvh_ray3_closest(&bvh, rays[i], 100.0f, &hit) ? 1 : 0;
+    }
+    double  t2  = now();
+
+    uint32_t    any     = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:any)
+    for( int i = 0; i < (int)ray_count; ++i ) {
+        any     += bvh_ray3_any(&bvh, rays[i], 100.0f) ? 1 : 0;
+    }
+    double  t3  = now();
+
+    printf("bvh: %u triangles, %u nodes, build %.1f ms\n", tri_count, bvh.node_count, (t1 - t0) * 1e3);
+    printf("bvh: %u rays, closest hit %.2f Mrays/s (%u hits), any hit %.2f Mrays/s (%u hits)\n",
+           ray_count, ray_count / (t2 - t1) * 1e-6, closest, ray_count / (t3 - t2) * 1e-6, any);
+
+    bvh_release(&bvh);
+    free(rays);
+    free(vertices);
+    free(indices);
+}
+
+/*******************************************************************************
+** sap: moving boxes, update and pair times per frame
+*******************************************************************************/
+#define SAP_FRAMES  16
+
+/* boxes of size 0.5 to 1.5 moving in a world of the given proportions, about 1 box per 16 units^3 */
+static
+void
+bench_sap_world(const char* name, uint32_t count, vec3_t shape) {
+    float       side    = cbrtf(16.0f * (float)count / (shape.x * shape.y * shape.z));
+    vec3_t      world   = vec3_mulf(shape, side);
+    box3_t*     boxes   = (box3_t*)malloc(sizeof(box3_t) * count);
+    vec3_t*     pos     = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    vec3_t*     vel     = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    float*      size    = (float*)malloc(sizeof(float) * count);
+    uint32_t    max_pairs   = 16 * count;
+    uint32_t*   pairs   = (uint32_t*)malloc(sizeof(uint32_t) * 2 * max_pairs);
+    sap_t       sap;
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        pos[i]  = vec3(frand() * world.x, frand() * world.y, frand() * world.z);
+        vel[i]  = vec3_mulf(vec3(frand() - 0.5f, frand() - 0.5f, frand() - 0.5f), 0.2f);
+        size[i] = 0.5f + frand();
+    }
+
+    sap_init(&sap, 0, count);
+
+    double      update  = 0.0;
+    double      sweep   = 0.0;
+    uint64_t    found   = 0;
+    for( uint32_t f = 0; f <= SAP_FRAMES; ++f ) {
+        for( uint32_t i = 0; i < count; ++i ) {
+            vec3_t  p   = vec3_add(pos[i], vel[i]);
+            if( p.x < 0.0f || p.x > world.x ) vel[i].x = -vel[i].x;
+            if( p.y < 0.0f || p.y > world.y ) vel[i].y = -vel[i].y;
+            if( p.z < 0.0f || p.z > world.z ) vel[i].z = -vel[i].z;
+            pos[i]      = vec3_add(pos[i], vel[i]);
+            boxes[i]    = box3(pos[i], vec3_add(pos[i], vec3(size[i], size[i], size[i])));
+        }
+
+        double  t0  = now();
+        sap_update(&sap, boxes, count);
+        double  t1  = now();
+        uint32_t    n   = sap_pairs(&sap, pairs, max_pairs);
+        double  t2  = now();
+
+        // the first frame sorts from scratch
+        if( f == 0 ) continue;
+        update  += t1 - t0;
+        sweep   += t2 - t1;
+        found   += n;
+    }
+
+    printf("sap: %-8s %6u boxes in %4.0f x %4.0f x %4.0f, sweep axis %u: update %6.2f ms, pairs %7.2f ms, %7.0f pairs/frame\n",
+           name, count, world.x, world.y, world.z, sap.axis,
+           update / SAP_FRAMES * 1e3, sweep / SAP_FRAMES * 1e3, (double)found / SAP_FRAMES);
+
+    sap_release(&sap);
+    free(boxes);
+    free(pos);
+    free(vel);
+    free(size);
+    free(pairs);
+}
+
+static
+void
+bench_sap(float scale) {
+    static const uint32_t   counts[3]   = { 10000, 30000, 100000 };
+    for( uint32_t i = 0; i < 3; ++i ) {
+        uint32_t    count   = (uint32_t)(counts[i] * scale);
+        bench_sap_world("cube", count, vec3(1.0f, 1.0f, 1.0f));
+        bench_sap_world("corridor", count, vec3(1.0f, 1.0f, 16.0f));
+    }
+}
+
+/*******************************************************************************
+** skin: linear blend skinning vertices per second
+*******************************************************************************/
+#define SKIN_JOINTS     64
+#define SKIN_REPEAT     16
+
+static
+void
+bench_skin(float scale) {
+    uint32_t    count       = (uint32_t)(1000000 * scale);
+    mat4_t      palette[SKIN_JOINTS];
+    vec3_t*     positions   = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    vec3_t*     normals     = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    vec3_t*     out_pos     = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    vec3_t*     out_nrm     = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    uint16_t*   joints      = (uint16_t*)malloc(sizeof(uint16_t) * 8 * count);
+    float*      weights     = (float*)malloc(sizeof(float) * 8 * count);
+
+    for( uint32_t j = 0; j < SKIN_JOINTS; ++j ) {
+        palette[j]  = mat4_mulm(mat4_translation(vec3(frand(), frand(), frand())),
+                                mat4_rotation2(frand() * 6.0f, vec3(frand() - 0.5f, frand() - 0.5f, 1.0f)));
+    }
+    for( uint32_t i = 0; i < count; ++i ) {
+        positions[i]    = vec3(frand(), frand(), frand());
+        normals[i]      = vec3_normalize(vec3(frand() - 0.5f, frand() - 0.5f, 1.0f));
+    }
+
+    for( uint32_t influences = 4; influences <= 8; influences += 4 ) {
+        for( uint32_t i = 0; i < count; ++i ) {
+            float   sum = 0.0f;
+            for( uint32_t k = 0; k < influences; ++k ) {
+                joints[i * influences + k]  = (uint16_t)(frand() * SKIN_JOINTS);
+                weights[i * influences + k] = 0.1f + frand();
+                sum += weights[i * influences + k];
+            }
+            for( uint32_t k = 0; k < influences; ++k ) weights[i * influences + k] /= sum;
+        }
+
+        double  t0  = now();
+        for( uint32_t r = 0; r < SKIN_REPEAT; ++r )
+            skin_vertices(palette, joints, weights, influences, positions, normals, count, out_pos, out_nrm);
+        double  t1  = now();
+        for( uint32_t r = 0; r < SKIN_REPEAT; ++r )
+            skin_vertices(palette, joints, weights, influences, positions, NULL, count, out_pos, NULL);
+        double  t2  = now();
+
+        printf("skin: %u vertices, %u influences: positions and normals %.1f Mverts/s, positions %.1f Mverts/s\n",
+               count, influences, (double)count * SKIN_REPEAT / (t1 - t0) * 1e-6, (double)count * SKIN_REPEAT / (t2 - t1) * 1e-6);
+    }
+
+    free(positions);
+    free(normals);
+    free(out_pos);
+    free(out_nrm);
+    free(joints);
+    free(weights);
+}
+
+int
+main(int argc, char** argv) {
+    const char* only    = NULL;
+    float       scale   = 1.0f;
+
+    for( int i = 1; i < argc; ++i ) {
+        if( atof(argv[i]) > 0.0 ) scale = (float)atof(argv[i]);
+        else only = argv[i];
+    }
+
+    printf("%d thread(s), scale %g\n", threads(), scale);
+    if( !only || !strcmp(only, "bvh") ) bench_bvh(scale);
+    if( !only || !strcmp(only, "sap") ) bench_sap(scale);
+    if( !only || !strcmp(only, "skin") ) bench_skin(scale);
+    return 0;
+}
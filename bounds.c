@@ -0,0 +1,478 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+
+#define BOUNDS_LANES            8       /* independent accumulators, one vector register wide */
+#define BOUNDS_CHUNK            4096    /* minimum points per parallel chunk */
+#define BOUNDS_MAX_CHUNKS       256
+#define SPHERE_REFINE_PASSES    8       /* shrink and regrow passes of the bounding sphere */
+#define SPHERE_SHRINK           0.95f
+#define SPHERE_BLOCK            1024      /* contiguous points per block of a regrow pass */
+#define JACOBI_SWEEPS           32
+
+/*
+ * the arrays are split in at most BOUNDS_MAX_CHUNKS chunks reduced in
+ * parallel, each one into its slot of a small array folded afterwards: the
+ * result does not depend on the thread count
+ */
+static INLINE
+uint32_t
+chunk_size(uint32_t count) {
+    uint32_t    size    = (count + BOUNDS_MAX_CHUNKS - 1) / BOUNDS_MAX_CHUNKS;
+    return size > BOUNDS_CHUNK ? size : BOUNDS_CHUNK;
+}
+
+/* min/max of the projections of a range on three axes, lanes keep the loop branch free */
+static
+void
+project_range(const vec3_t* points, uint32_t begin, uint32_t end, mat3_t axes, vec3_t* pmin, vec3_t* pmax) {
+    float       mn[3][BOUNDS_LANES];
+    float       mx[3][BOUNDS_LANES];
+
+    for( uint32_t a = 0; a < 3; ++a ) {
+        for( uint32_t l = 0; l < BOUNDS_LANES; ++l ) {
+            mn[a][l]    = FLT_MAX;
+            mx[a][l]    = -FLT_MAX;
+        }
+    }
+
+    uint32_t    i   = begin;
+    for( ; i + BOUNDS_LANES <= end; i += BOUNDS_LANES ) {
+        for( uint32_t a = 0; a < 3; ++a ) {
+            vec3_t  ax  = axes.col[a];
+            for( uint32_t l = 0; l < BOUNDS_LANES; ++l ) {
+                vec3_t  p   = points[i + l];
+                float   d   = ax.x * p.x + ax.y * p.y + ax.z * p.z;
+                mn[a][l]    = d < mn[a][l] ? d : mn[a][l];
+                mx[a][l]    = d > mx[a][l] ? d : mx[a][l];
+            }
+        }
+    }
+    for( ; i < end; ++i ) {
+        for( uint32_t a = 0; a < 3; ++a ) {
+            float   d   = vec3_dot(axes.col[a], points[i]);
+            mn[a][0]    = d < mn[a][0] ? d : mn[a][0];
+            mx[a][0]    = d > mx[a][0] ? d : mx[a][0];
+        }
+    }
+
+    float   rmin[3], rmax[3];
+    for( uint32_t a = 0; a < 3; ++a ) {
+        rmin[a] = mn[a][0];
+        rmax[a] = mx[a][0];
+        for( uint32_t l = 1; l < BOUNDS_LANES; ++l ) {
+            rmin[a] = mn[a][l] < rmin[a] ? mn[a][l] : rmin[a];
+            rmax[a] = mx[a][l] > rmax[a] ? mx[a][l] : rmax[a];
+        }
+    }
+    *pmin   = vec3(rmin[0], rmin[1], rmin[2]);
+    *pmax   = vec3(rmax[0], rmax[1], rmax[2]);
+}
+
+/* bounds of the projections on three axes, (FLT_MAX, -FLT_MAX) when empty */
+static
+void
+project_points(const vec3_t* points, uint32_t count, mat3_t axes, vec3_t* pmin, vec3_t* pmax) {
+    uint32_t    size    = chunk_size(count);
+    int         chunks  = (int)((count + size - 1) / size);
+    vec3_t      cmin[BOUNDS_MAX_CHUNKS];
+    vec3_t      cmax[BOUNDS_MAX_CHUNKS];
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        project_range(points, begin, end, axes, &cmin[c], &cmax[c]);
+    }
+
+    *pmin   = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    *pmax   = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for( int c = 0; c < chunks; ++c ) {
+        *pmin   = vec3_min(*pmin, cmin[c]);
+        *pmax   = vec3_max(*pmax, cmax[c]);
+    }
+}
+
+static
+box3_t
+range_bounds(const vec3_t* points, uint32_t begin, uint32_t end) {
+    float       mn[3][BOUNDS_LANES];
+    float       mx[3][BOUNDS_LANES];
+
+    for( uint32_t l = 0; l < BOUNDS_LANES; ++l ) {
+        mn[0][l] = mn[1][l] = mn[2][l] = FLT_MAX;
+        mx[0][l] = mx[1][l] = mx[2][l] = -FLT_MAX;
+    }
+
+    uint32_t    i   = begin;
+    for( ; i + BOUNDS_LANES <= end; i += BOUNDS_LANES ) {
+        for( uint32_t l = 0; l < BOUNDS_LANES; ++l ) {
+            vec3_t  p   = points[i + l];
+            mn[0][l]    = p.x < mn[0][l] ? p.x : mn[0][l];
+            mn[1][l]    = p.y < mn[1][l] ? p.y : mn[1][l];
+            mn[2][l]    = p.z < mn[2][l] ? p.z : mn[2][l];
+            mx[0][l]    = p.x > mx[0][l] ? p.x : mx[0][l];
+            mx[1][l]    = p.y > mx[1][l] ? p.y : mx[1][l];
+            mx[2][l]    = p.z > mx[2][l] ? p.z : mx[2][l];
+        }
+    }
+
+    box3_t  b   = box3_empty();
+    for( ; i < end; ++i )
+        b   = box3_expand(b, points[i]);
+    for( uint32_t l = 0; l < BOUNDS_LANES; ++l ) {
+        b.min   = vec3_min(b.min, vec3(mn[0][l], mn[1][l], mn[2][l]));
+        b.max   = vec3_max(b.max, vec3(mx[0][l], mx[1][l], mx[2][l]));
+    }
+    return b;
+}
+
+box3_t
+box3_from_points(const vec3_t* points, uint32_t count) {
+    uint32_t    size    = chunk_size(count);
+    int         chunks  = (int)((count + size - 1) / size);
+    box3_t      cb[BOUNDS_MAX_CHUNKS];
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        cb[c]   = range_bounds(points, begin, end);
+    }
+
+    box3_t      b       = box3_empty();
+    for( int c = 0; c < chunks; ++c )
+        b   = box3_union(b, cb[c]);
+    return b;
+}
+
+/*******************************************************************************
+** moments, accumulated in double precision
+*******************************************************************************/
+vec3_t
+points_centroid(const vec3_t* points, uint32_t count) {
+    if( count == 0 ) return vec3(0.0f, 0.0f, 0.0f);
+
+    uint32_t    size    = chunk_size(count);
+    int         chunks  = (int)((count + size - 1) / size);
+    dvec3_t     sums[BOUNDS_MAX_CHUNKS];
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        double      sx = 0.0, sy = 0.0, sz = 0.0;
+        for( uint32_t i = begin; i < end; ++i ) {
+            sx  += points[i].x;
+            sy  += points[i].y;
+            sz  += points[i].z;
+        }
+        sums[c] = dvec3(sx, sy, sz);
+    }
+
+    dvec3_t     s   = dvec3(0.0, 0.0, 0.0);
+    for( int c = 0; c < chunks; ++c )
+        s   = dvec3_add(s, sums[c]);
+    return vec3((float)(s.x / count), (float)(s.y / count), (float)(s.z / count));
+}
+
+mat3_t
+points_covariance(const vec3_t* points, uint32_t count, vec3_t* centroid) {
+    vec3_t      m       = points_centroid(points, count);
+    uint32_t    size    = chunk_size(count);
+    int         chunks  = (int)((count + size - 1) / size);
+    double      sums[BOUNDS_MAX_CHUNKS][6];
+
+    if( centroid ) *centroid = m;
+    if( count == 0 ) return mat3(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        double      xx = 0.0, xy = 0.0, xz = 0.0, yy = 0.0, yz = 0.0, zz = 0.0;
+        for( uint32_t i = begin; i < end; ++i ) {
+            double  x   = points[i].x - m.x;
+            double  y   = points[i].y - m.y;
+            double  z   = points[i].z - m.z;
+            xx  += x * x;
+            xy  += x * y;
+            xz  += x * z;
+            yy  += y * y;
+            yz  += y * z;
+            zz  += z * z;
+        }
+        sums[c][0]  = xx;
+        sums[c][1]  = xy;
+        sums[c][2]  = xz;
+        sums[c][3]  = yy;
+        sums[c][4]  = yz;
+        sums[c][5]  = zz;
+    }
+
+    double  s[6]    = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for( int c = 0; c < chunks; ++c ) {
+        for( uint32_t k = 0; k < 6; ++k )
+            s[k]    += sums[c][k];
+    }
+    for( uint32_t k = 0; k < 6; ++k )
+        s[k]    /= count;
+
+    return mat3((float)s[0], (float)s[1], (float)s[2],
+                (float)s[1], (float)s[3], (float)s[4],
+                (float)s[2], (float)s[4], (float)s[5]);
+}
+
+/*******************************************************************************
+** eigen decomposition of a symmetric matrix (cyclic Jacobi)
+*******************************************************************************/
+void
+mat3_symmetric_eigen(mat3_t m, vec3_t* values, mat3_t* vectors) {
+    double  a[3][3];
+    double  v[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+
+    for( uint32_t i = 0; i < 3; ++i ) {
+        for( uint32_t j = 0; j < 3; ++j )
+            a[i][j] = m.m[i][j];
+    }
+
+    for( uint32_t sweep = 0; sweep < JACOBI_SWEEPS; ++sweep ) {
+        double  off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        double  dia = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if( off <= 1e-24 * dia || off == 0.0 ) break;
+
+        for( uint32_t p = 0; p < 2; ++p ) {
+            for( uint32_t q = p + 1; q < 3; ++q ) {
+                if( a[p][q] == 0.0 ) continue;
+
+                // rotation annihilating a[p][q]
+                double  theta   = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double  t       = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double  c       = 1.0 / sqrt(t * t + 1.0);
+                double  s       = t * c;
+
+                for( uint32_t k = 0; k < 3; ++k ) {
+                    double  akp = a[k][p];
+                    double  akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for( uint32_t k = 0; k < 3; ++k ) {
+                    double  apk = a[p][k];
+                    double  aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for( uint32_t k = 0; k < 3; ++k ) {
+                    double  vkp = v[k][p];
+                    double  vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    // decreasing eigenvalues, vectors in the columns
+    uint32_t    o[3]    = { 0, 1, 2 };
+    for( uint32_t i = 0; i < 2; ++i ) {
+        for( uint32_t j = i + 1; j < 3; ++j ) {
+            if( a[o[j]][o[j]] > a[o[i]][o[i]] ) {
+                uint32_t    t   = o[i];
+                o[i]    = o[j];
+                o[j]    = t;
+            }
+        }
+    }
+
+    *values = vec3((float)a[o[0]][o[0]], (float)a[o[1]][o[1]], (float)a[o[2]][o[2]]);
+    for( uint32_t c = 0; c < 3; ++c )
+        vectors->col[c] = vec3((float)v[0][o[c]], (float)v[1][o[c]], (float)v[2][o[c]]);
+}
+
+/*******************************************************************************
+** bounding sphere
+*******************************************************************************/
+/*
+ * grow the sphere over the points, visiting blocks of SPHERE_BLOCK points in
+ * a stride order: the order changes between passes while the accesses stay
+ * contiguous. Lanes of points all inside the sphere are skipped at once.
+ */
+static
+sphere_t
+ritter_grow(const vec3_t* points, uint32_t count, uint32_t stride, sphere_t s) {
+    uint32_t    blocks  = (count + SPHERE_BLOCK - 1) / SPHERE_BLOCK;
+    uint32_t    blk     = 0;
+
+    for( uint32_t k = 0; k < blocks; ++k ) {
+        uint32_t    end = (blk + 1) * SPHERE_BLOCK < count ? (blk + 1) * SPHERE_BLOCK : count;
+
+        for( uint32_t i = blk * SPHERE_BLOCK; i < end; i += BOUNDS_LANES ) {
+            uint32_t    n   = end - i < BOUNDS_LANES ? end - i : BOUNDS_LANES;
+            float       r2  = s.radius * s.radius;
+            bool        out = false;
+
+            for( uint32_t l = 0; l < n; ++l ) {
+                vec3_t  d   = vec3_sub(points[i + l], s.center);
+                out     |= vec3_dot(d, d) > r2;
+            }
+            if( !out ) continue;
+
+            for( uint32_t l = 0; l < n; ++l ) {
+                vec3_t  d   = vec3_sub(points[i + l], s.center);
+                float   dd  = vec3_dot(d, d);
+                if( dd <= s.radius * s.radius ) continue;
+
+                // the new sphere touches the point and the far side of the old one
+                float   dist    = sqrtf(dd);
+                float   r       = (s.radius + dist) * 0.5f;
+                s.center    = vec3_add(s.center, vec3_mulf(d, (r - s.radius) / dist));
+                s.radius    = r;
+            }
+        }
+        blk = blk + stride >= blocks ? blk + stride - blocks : blk + stride;
+    }
+    return s;
+}
+
+/* a step coprime with the count, visiting the blocks in a scattered order */
+static
+uint32_t
+scatter_stride(uint32_t count, uint32_t k) {
+    static const uint32_t   primes[]    = { 1, 7919, 104729, 15485863, 32452843, 49979687, 67867967, 86028121 };
+    uint32_t                p           = primes[k % (sizeof(primes) / sizeof(primes[0]))];
+    return count > 1 && count % p ? p % count : 1;
+}
+
+sphere_t
+sphere_from_points(const vec3_t* points, uint32_t count) {
+    if( count == 0 ) return sphere(vec3(0.0f, 0.0f, 0.0f), 0.0f);
+
+    // initial diameter: the most separated pair of extremes along 3 axes and 4 diagonals
+    static const float  k   = 0.57735026919f;
+    const vec3_t        dirs[7]     = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+                                        { k, k, k }, { k, k, -k }, { k, -k, k }, { -k, k, k } };
+    uint32_t            emin[7]     = { 0, 0, 0, 0, 0, 0, 0 };
+    uint32_t            emax[7]     = { 0, 0, 0, 0, 0, 0, 0 };
+    uint32_t            size        = chunk_size(count);
+    int                 chunks      = (int)((count + size - 1) / size);
+    uint32_t            cmin[BOUNDS_MAX_CHUNKS][7];
+    uint32_t            cmax[BOUNDS_MAX_CHUNKS][7];
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        float       pmin[7], pmax[7];
+        for( uint32_t d = 0; d < 7; ++d ) {
+            pmin[d] = pmax[d] = vec3_dot(dirs[d], points[begin]);
+            cmin[c][d] = cmax[c][d] = begin;
+        }
+        for( uint32_t i = begin + 1; i < end; ++i ) {
+            for( uint32_t d = 0; d < 7; ++d ) {
+                float   p   = vec3_dot(dirs[d], points[i]);
+                if( p < pmin[d] ) { pmin[d] = p; cmin[c][d] = i; }
+                if( p > pmax[d] ) { pmax[d] = p; cmax[c][d] = i; }
+            }
+        }
+    }
+
+    for( int c = 0; c < chunks; ++c ) {
+        for( uint32_t d = 0; d < 7; ++d ) {
+            if( vec3_dot(dirs[d], points[cmin[c][d]]) < vec3_dot(dirs[d], points[emin[d]]) ) emin[d] = cmin[c][d];
+            if( vec3_dot(dirs[d], points[cmax[c][d]]) > vec3_dot(dirs[d], points[emax[d]]) ) emax[d] = cmax[c][d];
+        }
+    }
+
+    uint32_t    best    = 0;
+    float       best_d  = -1.0f;
+    for( uint32_t d = 0; d < 7; ++d ) {
+        vec3_t  e   = vec3_sub(points[emax[d]], points[emin[d]]);
+        float   dd  = vec3_dot(e, e);
+        if( dd > best_d ) {
+            best_d  = dd;
+            best    = d;
+        }
+    }
+
+    sphere_t    s   = sphere(vec3_mulf(vec3_add(points[emin[best]], points[emax[best]]), 0.5f), sqrtf(best_d) * 0.5f);
+    s   = ritter_grow(points, count, 1, s);
+
+    // refinement: shrink, regrow in another order, keep the smaller sphere
+    for( uint32_t pass = 0; pass < SPHERE_REFINE_PASSES; ++pass ) {
+        sphere_t    t   = s;
+        t.radius    *= SPHERE_SHRINK;
+        t   = ritter_grow(points, count, scatter_stride((count + SPHERE_BLOCK - 1) / SPHERE_BLOCK, pass + 1), t);
+        if( t.radius < s.radius ) s = t;
+    }
+
+    // the incremental updates round, make sure every point is inside
+    float       dmax[BOUNDS_MAX_CHUNKS];
+
+#pragma omp parallel for
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < count ? begin + size : count;
+        float       m       = 0.0f;
+        for( uint32_t i = begin; i < end; ++i ) {
+            vec3_t  d   = vec3_sub(points[i], s.center);
+            float   dd  = vec3_dot(d, d);
+            m   = dd > m ? dd : m;
+        }
+        dmax[c] = m;
+    }
+    for( int c = 0; c < chunks; ++c )
+        s.radius    = fmaxf(s.radius, sqrtf(dmax[c]));
+    return s;
+}
+
+/*******************************************************************************
+** oriented box
+*******************************************************************************/
+obb3_t
+obb3_from_points(const vec3_t* points, uint32_t count) {
+    if( count == 0 ) return obb3(vec3(0.0f, 0.0f, 0.0f), mat3_identity(), vec3(0.0f, 0.0f, 0.0f));
+
+    vec3_t  values;
+    mat3_t  axes;
+    mat3_symmetric_eigen(points_covariance(points, count, NULL), &values, &axes);
+
+    // right handed, the third axis is the cross product of the two main ones
+    axes.col[0] = vec3_normalize(axes.col[0]);
+    axes.col[1] = vec3_normalize(vec3_sub(axes.col[1], vec3_mulf(axes.col[0], vec3_dot(axes.col[0], axes.col[1]))));
+    axes.col[2] = vec3_cross(axes.col[0], axes.col[1]);
+
+    vec3_t  pmin, pmax;
+    project_points(points, count, axes, &pmin, &pmax);
+
+    vec3_t  mid     = vec3_mulf(vec3_add(pmin, pmax), 0.5f);
+    vec3_t  ext     = vec3_mulf(vec3_sub(pmax, pmin), 0.5f);
+    obb3_t  o       = obb3(mat3_mul_vec3(axes, mid), axes, ext);
+
+    // the principal axes are arbitrary for isotropic sets (a cube), keep the tighter box
+    box3_t  b       = box3_from_points(points, count);
+    vec3_t  bext    = box3_extent(b);
+    if( bext.x * bext.y * bext.z <= ext.x * ext.y * ext.z ) o = obb3_from_box3(b);
+    return o;
+}
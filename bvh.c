@@ -0,0 +1,863 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define EPSILON             (1.0f / (1024.0f * 1024.f))
+
+#define BVH_BIN_COUNT       16
+#define BVH_TASK_THRESHOLD  4096    /* subtrees smaller than this are built by the current thread */
+#define BVH_SAH_MAX_DEPTH   64      /* deeper than this, split at the median to bound the tree depth */
+#define BVH_STACK_SIZE      128     /* BVH_SAH_MAX_DEPTH + log2(UINT32_MAX) */
+
+#define TRAVERSAL_COST      1.0f
+#define INTERSECTION_COST   1.0f
+
+typedef struct {
+    box3_t          bounds;
+    uint32_t        count;
+} bin_t;
+
+typedef struct {
+    bvh_node_t*     nodes;
+    uint32_t        node_count;
+    uint32_t*       indices;
+    const box3_t*   bounds;
+    const vec3_t*   centroids;
+    uint32_t        max_leaf_size;
+    const uint32_t* free_pairs;     /* node pairs to reuse before growing node_count (subtree rebuilds) */
+    uint32_t        free_count;
+    uint32_t        free_next;
+} build_t;
+
+static
+uint32_t
+alloc_node_pair(build_t* b) {
+    uint32_t    slot;
+#pragma omp atomic capture
+    slot = b->free_next++;
+    if( slot < b->free_count ) return b->free_pairs[slot];
+
+    uint32_t    first;
+#pragma omp atomic capture
+    { first = b->node_count; b->node_count += 2; }
+    return first;
+}
+
+static INLINE
+uint32_t
+bin_of(float c, float cmin, float scale) {
+    int     i   = (int)((c - cmin) * scale);
+    return (uint32_t)(i < 0 ? 0 : (i >= BVH_BIN_COUNT ? BVH_BIN_COUNT - 1 : i));
+}
+
+///
+/// binned SAH (I. Wald, On fast Construction of SAH-based Bounding Volume Hierarchies, 2007)
+/// evaluates BVH_BIN_COUNT - 1 split planes on each axis and returns false if no split beats
+/// the cost of a leaf
+///
+static
+bool
+find_sah_split(const build_t* b, uint32_t begin, uint32_t end, box3_t nb, box3_t cb, uint32_t* axis, uint32_t* split) {
+    float       best_cost   = FLT_MAX;
+    uint32_t    count       = end - begin;
+
+    for( uint32_t a = 0; a < 3; ++a ) {
+        float   cmin    = vec3_axis(cb.min, a);
+        float   extent  = vec3_axis(cb.max, a) - cmin;
+        if( extent <= EPSILON ) continue;
+
+        float   scale   = (float)BVH_BIN_COUNT / extent;
+        bin_t   bins[BVH_BIN_COUNT];
+        for( uint32_t i = 0; i < BVH_BIN_COUNT; ++i ) {
+            bins[i].bounds  = box3_empty();
+            bins[i].count   = 0;
+        }
+
+        for( uint32_t i = begin; i < end; ++i ) {
+            uint32_t    p   = b->indices[i];
+            uint32_t    bi  = bin_of(vec3_axis(b->centroids[p], a), cmin, scale);
+            bins[bi].bounds = box3_union(bins[bi].bounds, b->bounds[p]);
+            bins[bi].count++;
+        }
+
+        // sweep from the right to get the cost of the right side of each plane
+        float       right_area[BVH_BIN_COUNT];
+        uint32_t    right_count[BVH_BIN_COUNT];
+        box3_t      acc     = box3_empty();
+        uint32_t    n       = 0;
+        for( uint32_t i = BVH_BIN_COUNT - 1; i > 0; --i ) {
+            acc     = box3_union(acc, bins[i].bounds);
+            n       += bins[i].count;
+            right_area[i]   = box3_surface_area(acc);
+            right_count[i]  = n;
+        }
+
+        acc     = box3_empty();
+        n       = 0;
+        for( uint32_t i = 0; i < BVH_BIN_COUNT - 1; ++i ) {
+            acc     = box3_union(acc, bins[i].bounds);
+            n       += bins[i].count;
+            if( n == 0 || n == count ) continue;
+
+            float   cost    = box3_surface_area(acc) * (float)n + right_area[i + 1] * (float)right_count[i + 1];
+            if( cost < best_cost ) {
+                best_cost   = cost;
+                *axis       = a;
+                *split      = i + 1;
+            }
+        }
+    }
+
+    if( best_cost == FLT_MAX ) return false;
+
+    float   area        = box3_surface_area(nb);
+    float   split_cost  = TRAVERSAL_COST * area + INTERSECTION_COST * best_cost;
+    float   leaf_cost   = INTERSECTION_COST * area * (float)count;
+    return split_cost < leaf_cost || count > b->max_leaf_size;
+}
+
+static
+void
+build_node(build_t* b, uint32_t node, uint32_t begin, uint32_t end, uint32_t depth) {
+    box3_t      nb      = box3_empty();
+    box3_t      cb      = box3_empty();
+    uint32_t    count   = end - begin;
+
+    for( uint32_t i = begin; i < end; ++i ) {
+        uint32_t    p   = b->indices[i];
+        nb  = box3_union(nb, b->bounds[p]);
+        cb  = box3_expand(cb, b->centroids[p]);
+    }
+
+    b->nodes[node].bounds   = nb;
+    b->nodes[node].first    = begin;
+    b->nodes[node].count    = count;
+
+    if( count <= 1 ) return;
+
+    uint32_t    mid     = begin;
+    uint32_t    axis    = 0, split = 0;
+    if( depth < BVH_SAH_MAX_DEPTH && find_sah_split(b, begin, end, nb, cb, &axis, &split) ) {
+        float       cmin    = vec3_axis(cb.min, axis);
+        float       scale   = (float)BVH_BIN_COUNT / (vec3_axis(cb.max, axis) - cmin);
+        uint32_t    i       = begin;
+        uint32_t    j       = end;
+        while( i < j ) {
+            if( bin_of(vec3_axis(b->centroids[b->indices[i]], axis), cmin, scale) < split ) {
+                ++i;
+            } else {
+                uint32_t    tmp = b->indices[i];
+                b->indices[i]   = b->indices[--j];
+                b->indices[j]   = tmp;
+            }
+        }
+        mid = i;
+    } else if( count > b->max_leaf_size ) {
+        mid = begin + count / 2;    // coincident centroids or too deep, split by index
+    } else {
+        return;                     // SAH prefers a leaf
+    }
+
+    if( mid == begin || mid == end ) mid = begin + count / 2;
+
+    uint32_t    child   = alloc_node_pair(b);
+    b->nodes[node].first    = child;
+    b->nodes[node].count    = 0;
+
+    if( count > BVH_TASK_THRESHOLD ) {
+#pragma omp task firstprivate(b, child, begin, mid, depth)
+        build_node(b, child, begin, mid, depth + 1);
+    } else {
+        build_node(b, child, begin, mid, depth + 1);
+    }
+    build_node(b, child + 1, mid, end, depth + 1);
+}
+
+bool
+bvh_build(bvh_t* bvh, const box3_t* prim_bounds, uint32_t count, uint32_t max_leaf_size) {
+    memset(bvh, 0, sizeof(bvh_t));
+    if( count == 0 ) return false;
+
+    vec3_t*     centroids   = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    bvh->nodes              = (bvh_node_t*)malloc(sizeof(bvh_node_t) * (2 * (size_t)count - 1));
+    bvh->prim_indices       = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    if( !centroids || !bvh->nodes || !bvh->prim_indices ) {
+        free(centroids);
+        bvh_release(bvh);
+        return false;
+    }
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        centroids[i]            = box3_center(prim_bounds[i]);
+        bvh->prim_indices[i]    = (uint32_t)i;
+    }
+
+    build_t     b;
+    b.nodes         = bvh->nodes;
+    b.node_count    = 1;
+    b.indices       = bvh->prim_indices;
+    b.bounds        = prim_bounds;
+    b.centroids     = centroids;
+    b.max_leaf_size = max_leaf_size ? max_leaf_size : 1;
+    b.free_pairs    = NULL;
+    b.free_count    = 0;
+    b.free_next     = 0;
+
+#pragma omp parallel
+#pragma omp single nowait
+    build_node(&b, 0, 0, count, 0);
+
+    free(centroids);
+
+    bvh->node_count     = b.node_count;
+    bvh->prim_count     = count;
+    bvh->max_leaf_size  = b.max_leaf_size;
+
+    // shrink to the used node count
+    bvh_node_t* nodes   = (bvh_node_t*)realloc(bvh->nodes, sizeof(bvh_node_t) * bvh->node_count);
+    if( nodes ) bvh->nodes = nodes;
+    return true;
+}
+
+static INLINE
+box3_t
+tri_bounds(tri3_mesh_t mesh, uint32_t tri) {
+    vec3_t  v0, v1, v2;
+    tri3_mesh_triangle(mesh, tri, &v0, &v1, &v2);
+    return box3_expand(box3(v0, v1), v2);
+}
+
+typedef bool (*bvh_builder_t)(bvh_t* bvh, const box3_t* prim_bounds, uint32_t count, uint32_t max_leaf_size);
+
+static
+bool
+build_tri3(bvh_t* bvh, tri3_mesh_t mesh, uint32_t max_leaf_size, bvh_builder_t builder) {
+    if( mesh.tri_count == 0 ) {
+        memset(bvh, 0, sizeof(bvh_t));
+        return false;
+    }
+
+    box3_t*     bounds  = (box3_t*)malloc(sizeof(box3_t) * mesh.tri_count);
+    if( !bounds ) {
+        memset(bvh, 0, sizeof(bvh_t));
+        return false;
+    }
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)mesh.tri_count; ++i ) {
+        bounds[i]   = tri_bounds(mesh, (uint32_t)i);
+    }
+
+    bool    ret = builder(bvh, bounds, mesh.tri_count, max_leaf_size);
+    free(bounds);
+    if( !ret ) return false;
+
+    bvh->mesh           = mesh;
+    bvh->group_count    = tri3_group_count(mesh.tri_count);
+    bvh->groups         = (tri3_group_t*)malloc(sizeof(tri3_group_t) * bvh->group_count);
+    if( !bvh->groups ) {
+        bvh_release(bvh);
+        return false;
+    }
+    tri3_group_build(bvh->groups, mesh, bvh->prim_indices, mesh.tri_count);
+    return true;
+}
+
+bool
+bvh_build_tri3(bvh_t* bvh, tri3_mesh_t mesh, uint32_t max_leaf_size) {
+    return build_tri3(bvh, mesh, max_leaf_size, bvh_build);
+}
+
+bool
+bvh_build_lbvh_tri3(bvh_t* bvh, tri3_mesh_t mesh, uint32_t max_leaf_size) {
+    return build_tri3(bvh, mesh, max_leaf_size, bvh_build_lbvh);
+}
+
+void
+bvh_release(bvh_t* bvh) {
+    free(bvh->nodes);
+    free(bvh->prim_indices);
+    free(bvh->groups);
+    free(bvh->sah_cost);
+    free(bvh->sah_ref);
+    free(bvh->levels);
+    free(bvh->level_start);
+    memset(bvh, 0, sizeof(bvh_t));
+}
+
+/*******************************************************************************
+** refit
+*******************************************************************************/
+/* breadth first order of the reachable nodes, split by depth */
+static
+bool
+compute_levels(bvh_t* bvh) {
+    free(bvh->levels);
+    free(bvh->level_start);
+    bvh->levels         = (uint32_t*)malloc(sizeof(uint32_t) * bvh->node_count);
+    bvh->level_start    = (uint32_t*)malloc(sizeof(uint32_t) * (bvh->node_count / 2 + 2));
+    bvh->level_count    = 0;
+    if( !bvh->levels || !bvh->level_start ) return false;
+
+    uint32_t    head    = 0;
+    uint32_t    tail    = 0;
+    uint32_t    level   = 0;
+    bvh->levels[tail++] = 0;
+    while( head < tail ) {
+        uint32_t    end = tail;
+        bvh->level_start[level++]   = head;
+        for( ; head < end; ++head ) {
+            const bvh_node_t*   n   = &bvh->nodes[bvh->levels[head]];
+            if( n->count == 0 ) {
+                bvh->levels[tail++] = n->first;
+                bvh->levels[tail++] = n->first + 1;
+            }
+        }
+    }
+    bvh->level_start[level] = tail;
+    bvh->level_count        = level;
+    return true;
+}
+
+///
+/// bottom up pass over the levels, the nodes of a level are independent. Leaves take the
+/// union of their primitive bounds (the mesh triangles when prim_bounds is NULL), inner
+/// nodes the union of their children. The subtree SAH costs are updated along.
+///
+static
+void
+update_levels(bvh_t* bvh, const box3_t* prim_bounds, bool update_bounds) {
+    for( uint32_t l = bvh->level_count; l-- > 0; ) {
+#pragma omp parallel for
+        for( int k = (int)bvh->level_start[l]; k < (int)bvh->level_start[l + 1]; ++k ) {
+            uint32_t        ni  = bvh->levels[k];
+            bvh_node_t*     n   = &bvh->nodes[ni];
+            if( n->count ) {
+                if( update_bounds ) {
+                    box3_t  b   = box3_empty();
+                    for( uint32_t i = n->first; i < n->first + n->count; ++i ) {
+                        uint32_t    p   = bvh->prim_indices[i];
+                        b   = box3_union(b, prim_bounds ? prim_bounds[p] : tri_bounds(bvh->mesh, p));
+                    }
+                    n->bounds   = b;
+                }
+                bvh->sah_cost[ni]   = INTERSECTION_COST * box3_surface_area(n->bounds) * (float)n->count;
+            } else {
+                if( update_bounds ) {
+                    n->bounds   = box3_union(bvh->nodes[n->first].bounds, bvh->nodes[n->first + 1].bounds);
+                }
+                bvh->sah_cost[ni]   = TRAVERSAL_COST * box3_surface_area(n->bounds) +
+                                      bvh->sah_cost[n->first] + bvh->sah_cost[n->first + 1];
+            }
+        }
+    }
+}
+
+/* subtree cost per unit of its root surface area, as bvh_sah_cost: uniform scaling leaves it unchanged */
+static
+float
+normalized_cost(const bvh_t* bvh, uint32_t node) {
+    float   a   = box3_surface_area(bvh->nodes[node].bounds);
+    return a > 0.0f ? bvh->sah_cost[node] / a : 0.0f;
+}
+
+/* the reference costs are those of the hierarchy as built, captured before the first refit */
+static
+bool
+init_refit(bvh_t* bvh) {
+    if( bvh->sah_cost ) return true;
+
+    bvh->sah_cost   = (float*)malloc(sizeof(float) * bvh->node_count);
+    bvh->sah_ref    = (float*)malloc(sizeof(float) * bvh->node_count);
+    if( !bvh->sah_cost || !bvh->sah_ref || !compute_levels(bvh) ) {
+        free(bvh->sah_cost);
+        free(bvh->sah_ref);
+        bvh->sah_cost   = NULL;
+        bvh->sah_ref    = NULL;
+        return false;
+    }
+
+    update_levels(bvh, NULL, false);
+    for( uint32_t ni = 0; ni < bvh->node_count; ++ni )
+        bvh->sah_ref[ni]    = normalized_cost(bvh, ni);
+    return true;
+}
+
+bool
+bvh_refit(bvh_t* bvh, const box3_t* prim_bounds) {
+    if( bvh->node_count == 0 || !init_refit(bvh) ) return false;
+    update_levels(bvh, prim_bounds, true);
+    return true;
+}
+
+bool
+bvh_refit_tri3(bvh_t* bvh, const vec3_t* vertices) {
+    if( vertices ) bvh->mesh.vertices = vertices;
+    if( bvh->node_count == 0 || !init_refit(bvh) ) return false;
+    update_levels(bvh, NULL, true);
+    tri3_group_build(bvh->groups, bvh->mesh, bvh->prim_indices, bvh->prim_count);
+    return true;
+}
+
+static
+float
+subtree_cost(const bvh_t* bvh, uint32_t node) {
+    const bvh_node_t*   n   = &bvh->nodes[node];
+    float               a   = box3_surface_area(n->bounds);
+    if( n->count ) return INTERSECTION_COST * a * (float)n->count;
+    return TRAVERSAL_COST * a + subtree_cost(bvh, n->first) + subtree_cost(bvh, n->first + 1);
+}
+
+float
+bvh_sah_cost(const bvh_t* bvh) {
+    if( bvh->node_count == 0 ) return 0.0f;
+    float   a   = box3_surface_area(bvh->nodes[0].bounds);
+    return a > 0.0f ? subtree_cost(bvh, 0) / a : 0.0f;
+}
+
+///
+/// rebuild a subtree in place: the root keeps its index, the node pairs of the old subtree
+/// are reused first and the node array grows only when the new subtree needs more nodes.
+/// Pairs left over stay unreferenced.
+///
+static
+bool
+rebuild_subtree(bvh_t* bvh, const box3_t* prim_bounds, vec3_t* centroids, uint32_t root, uint32_t depth) {
+    uint32_t*   pairs   = (uint32_t*)malloc(sizeof(uint32_t) * (bvh->node_count / 2 + 1));
+    if( !pairs ) return false;
+
+    uint32_t    pair_count  = 0;
+    uint32_t    begin       = UINT32_MAX;
+    uint32_t    end         = 0;
+    uint32_t    stack[BVH_STACK_SIZE];
+    uint32_t    sp          = 0;
+
+    stack[sp++] = root;
+    while( sp ) {
+        const bvh_node_t*   n   = &bvh->nodes[stack[--sp]];
+        if( n->count ) {
+            begin   = n->first < begin ? n->first : begin;
+            end     = n->first + n->count > end ? n->first + n->count : end;
+        } else {
+            pairs[pair_count++] = n->first;
+            stack[sp++] = n->first;
+            stack[sp++] = n->first + 1;
+        }
+    }
+
+    uint32_t    needed  = end - begin - 1;
+    if( needed > pair_count ) {
+        bvh_node_t* nodes   = (bvh_node_t*)realloc(bvh->nodes, sizeof(bvh_node_t) * (bvh->node_count + 2 * (needed - pair_count)));
+        if( !nodes ) {
+            free(pairs);
+            return false;
+        }
+        bvh->nodes  = nodes;
+    }
+
+    for( uint32_t i = begin; i < end; ++i ) {
+        uint32_t    p   = bvh->prim_indices[i];
+        centroids[p]    = box3_center(prim_bounds[p]);
+    }
+
+    build_t     b;
+    b.nodes         = bvh->nodes;
+    b.node_count    = bvh->node_count;
+    b.indices       = bvh->prim_indices;
+    b.bounds        = prim_bounds;
+    b.centroids     = centroids;
+    b.max_leaf_size = bvh->max_leaf_size ? bvh->max_leaf_size : 1;
+    b.free_pairs    = pairs;
+    b.free_count    = pair_count;
+    b.free_next     = 0;
+
+#pragma omp parallel
+#pragma omp single nowait
+    build_node(&b, root, begin, end, depth);
+
+    bvh->node_count = b.node_count;
+    free(pairs);
+    return true;
+}
+
+uint32_t
+bvh_rebuild_degraded(bvh_t* bvh, const box3_t* prim_bounds, float max_growth) {
+    if( !bvh->sah_ref ) return 0;
+
+    uint32_t*   selected    = (uint32_t*)malloc(sizeof(uint32_t) * (bvh->node_count / 2 + 1) * 2);
+    vec3_t*     centroids   = (vec3_t*)malloc(sizeof(vec3_t) * bvh->prim_count);
+    uint32_t    count       = 0;
+    if( !selected || !centroids ) {
+        free(selected);
+        free(centroids);
+        return 0;
+    }
+
+    // topmost inner nodes whose subtree cost grew too much, with their depth
+    uint32_t    stack[2 * BVH_STACK_SIZE];
+    uint32_t    sp  = 0;
+    stack[sp++] = 0;
+    stack[sp++] = 0;
+    while( sp ) {
+        uint32_t            depth   = stack[--sp];
+        uint32_t            ni      = stack[--sp];
+        const bvh_node_t*   n       = &bvh->nodes[ni];
+        if( n->count ) continue;
+
+        if( normalized_cost(bvh, ni) > max_growth * bvh->sah_ref[ni] ) {
+            selected[2 * count]     = ni;
+            selected[2 * count + 1] = depth;
+            ++count;
+        } else {
+            stack[sp++] = n->first;
+            stack[sp++] = depth + 1;
+            stack[sp++] = n->first + 1;
+            stack[sp++] = depth + 1;
+        }
+    }
+
+    uint32_t    rebuilt = 0;
+    for( uint32_t i = 0; i < count; ++i ) {
+        if( rebuild_subtree(bvh, prim_bounds, centroids, selected[2 * i], selected[2 * i + 1]) ) {
+            selected[rebuilt++] = selected[2 * i];
+        }
+    }
+    free(centroids);
+
+    if( rebuilt ) {
+        float*  cost    = (float*)realloc(bvh->sah_cost, sizeof(float) * bvh->node_count);
+        if( cost ) bvh->sah_cost = cost;
+        float*  ref     = (float*)realloc(bvh->sah_ref, sizeof(float) * bvh->node_count);
+        if( ref ) bvh->sah_ref = ref;
+
+        if( !cost || !ref || !compute_levels(bvh) ) {
+            // keep the hierarchy usable, drop the refit state
+            free(bvh->sah_cost);
+            free(bvh->sah_ref);
+            bvh->sah_cost   = NULL;
+            bvh->sah_ref    = NULL;
+        } else {
+            update_levels(bvh, NULL, false);
+
+            // the rebuilt subtrees are the new reference
+            for( uint32_t i = 0; i < rebuilt; ++i ) {
+                sp  = 0;
+                stack[sp++] = selected[i];
+                while( sp ) {
+                    uint32_t            ni  = stack[--sp];
+                    const bvh_node_t*   n   = &bvh->nodes[ni];
+                    bvh->sah_ref[ni]    = normalized_cost(bvh, ni);
+                    if( n->count == 0 ) {
+                        stack[sp++] = n->first;
+                        stack[sp++] = n->first + 1;
+                    }
+                }
+            }
+        }
+    }
+
+    free(selected);
+    return rebuilt;
+}
+
+uint32_t
+bvh_rebuild_degraded_tri3(bvh_t* bvh, float max_growth) {
+    if( !bvh->sah_ref ) return 0;
+
+    box3_t*     bounds  = (box3_t*)malloc(sizeof(box3_t) * bvh->prim_count);
+    if( !bounds ) return 0;
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)bvh->prim_count; ++i ) {
+        bounds[i]   = tri_bounds(bvh->mesh, (uint32_t)i);
+    }
+
+    uint32_t    rebuilt = bvh_rebuild_degraded(bvh, bounds, max_growth);
+    if( rebuilt ) {
+        tri3_group_build(bvh->groups, bvh->mesh, bvh->prim_indices, bvh->prim_count);
+    }
+    free(bounds);
+    return rebuilt;
+}
+
+///
+/// leaf kernel: the leaf primitives [first, first + count) are contiguous in the group
+/// array, a leaf spans one or two groups (when max_leaf_size <= TRI3_GROUP_SIZE)
+///
+static INLINE
+bool
+intersect_leaf(const bvh_t* bvh, ray3_t r, const bvh_node_t* n, float tmax, tri3_hit_t* hit) {
+    uint32_t    end     = n->first + n->count;
+    bool        found   = false;
+    for( uint32_t g = n->first / TRI3_GROUP_SIZE; g * TRI3_GROUP_SIZE < end; ++g ) {
+        uint32_t    base    = g * TRI3_GROUP_SIZE;
+        uint32_t    lo      = n->first > base ? n->first - base : 0;
+        uint32_t    hi      = end - base < TRI3_GROUP_SIZE ? end - base : TRI3_GROUP_SIZE;
+        uint32_t    mask    = (TRI3_GROUP_MASK_ALL >> (TRI3_GROUP_SIZE - hi)) & (TRI3_GROUP_MASK_ALL << lo);
+        if( ray3_tri3_group_intersection(r, &bvh->groups[g], mask, tmax, hit) ) {
+            found   = true;
+            tmax    = hit->t;
+        }
+    }
+    return found;
+}
+
+typedef struct {
+    uint32_t    node;
+    float       tmin;
+} stack_entry_t;
+
+///
+/// ordered traversal: the nearer child is visited first, entries farther than the current
+/// closest hit are skipped when popped. With any_hit the first hit terminates the traversal.
+///
+static
+bool
+traverse(const bvh_t* bvh, ray3_t r, float tmax, bool any_hit, tri3_hit_t* hit) {
+    if( bvh->node_count == 0 ) return false;
+
+    ray3_inv_t      ri      = ray3_inv(r);
+    stack_entry_t   stack[BVH_STACK_SIZE];
+    uint32_t        sp      = 0;
+    bool            found   = false;
+    float           best    = tmax;
+    float           t0, t1;
+
+    if( !intersect_box3_ray3_inv(bvh->nodes[0].bounds, ri, 0.0f, best, &t0, NULL) ) return false;
+
+    stack[sp].node  = 0;
+    stack[sp].tmin  = t0;
+    ++sp;
+
+    while( sp ) {
+        --sp;
+        if( stack[sp].tmin > best ) continue;
+
+        const bvh_node_t*   n   = &bvh->nodes[stack[sp].node];
+        if( n->count ) {
+            tri3_hit_t  h;
+            if( intersect_leaf(bvh, r, n, best, &h) ) {
+                found   = true;
+                best    = h.t;
+                if( hit ) *hit = h;
+                if( any_hit ) return true;
+            }
+        } else {
+            bool    h0  = intersect_box3_ray3_inv(bvh->nodes[n->first].bounds, ri, 0.0f, best, &t0, NULL);
+            bool    h1  = intersect_box3_ray3_inv(bvh->nodes[n->first + 1].bounds, ri, 0.0f, best, &t1, NULL);
+
+            if( h0 && h1 ) {
+                uint32_t    near    = t0 <= t1 ? n->first : n->first + 1;
+                stack[sp].node  = near == n->first ? n->first + 1 : n->first;
+                stack[sp].tmin  = t0 <= t1 ? t1 : t0;
+                ++sp;
+                stack[sp].node  = near;
+                stack[sp].tmin  = t0 <= t1 ? t0 : t1;
+                ++sp;
+            } else if( h0 ) {
+                stack[sp].node  = n->first;
+                stack[sp].tmin  = t0;
+                ++sp;
+            } else if( h1 ) {
+                stack[sp].node  = n->first + 1;
+                stack[sp].tmin  = t1;
+                ++sp;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool
+bvh_ray3_closest(const bvh_t* bvh, ray3_t r, float tmax, tri3_hit_t* hit) {
+    return traverse(bvh, r, tmax, false, hit);
+}
+
+bool
+bvh_ray3_any(const bvh_t* bvh, ray3_t r, float tmax) {
+    return traverse(bvh, r, tmax, true, NULL);
+}
+
+///
+/// closest point traversal, same ordering as traverse() with squared box distances: the
+/// nearer child is visited first and entries beyond the closest triangle are skipped.
+///
+bool
+bvh_closest_point(const bvh_t* bvh, vec3_t pt, float max_distance, tri3_closest_t* out) {
+    if( bvh->node_count == 0 ) return false;
+
+    stack_entry_t   stack[BVH_STACK_SIZE];
+    uint32_t        sp      = 0;
+    bool            found   = false;
+    float           best    = max_distance < INFINITY ? max_distance * max_distance : INFINITY;
+    float           d0, d1;
+
+    d0  = box3_sqr_distance(bvh->nodes[0].bounds, pt);
+    if( d0 > best ) return false;
+
+    stack[sp].node  = 0;
+    stack[sp].tmin  = d0;
+    ++sp;
+
+    while( sp ) {
+        --sp;
+        if( stack[sp].tmin > best ) continue;
+
+        const bvh_node_t*   n   = &bvh->nodes[stack[sp].node];
+        if( n->count ) {
+            for( uint32_t i = n->first; i < n->first + n->count; ++i ) {
+                uint32_t    tri = bvh->prim_indices[i];
+                vec3_t      v0, v1, v2;
+                vec2_t      uv;
+                tri3_mesh_triangle(bvh->mesh, tri, &v0, &v1, &v2);
+
+                vec3_t      c   = closest_point_on_tri3(v0, v1, v2, pt, &uv);
+                vec3_t      d   = vec3_sub(c, pt);
+                float       dd  = vec3_dot(d, d);
+                if( dd <= best ) {
+                    found           = true;
+                    best            = dd;
+                    out->point      = c;
+                    out->u          = uv.x;
+                    out->v          = uv.y;
+                    out->tri        = tri;
+                }
+            }
+        } else {
+            d0  = box3_sqr_distance(bvh->nodes[n->first].bounds, pt);
+            d1  = box3_sqr_distance(bvh->nodes[n->first + 1].bounds, pt);
+
+            uint32_t    near    = d0 <= d1 ? n->first : n->first + 1;
+            float       dn      = d0 <= d1 ? d0 : d1;
+            float       df      = d0 <= d1 ? d1 : d0;
+            if( df <= best ) {
+                stack[sp].node  = near == n->first ? n->first + 1 : n->first;
+                stack[sp].tmin  = df;
+                ++sp;
+            }
+            if( dn <= best ) {
+                stack[sp].node  = near;
+                stack[sp].tmin  = dn;
+                ++sp;
+            }
+        }
+    }
+
+    if( found ) out->distance = sqrtf(best);
+    return found;
+}
+
+uint32_t
+bvh_closest_point_array(const bvh_t* bvh, const vec3_t* pts, uint32_t count, float max_distance, tri3_closest_t* out, bool* found) {
+    int     total   = 0;
+
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:total)
+    for( int i = 0; i < (int)count; ++i ) {
+        bool    f   = bvh_closest_point(bvh, pts[i], max_distance, &out[i]);
+        if( found ) found[i] = f;
+        total   += f ? 1 : 0;
+    }
+
+    return (uint32_t)total;
+}
+
+typedef struct {
+    uint32_t    node;
+    uint32_t    mask;
+} packet_entry_t;
+
+///
+/// packet traversal: every node is fetched once and tested against all the lanes still
+/// active for it. Children are pushed with the parent's hit mask and re-tested when popped,
+/// so lanes whose tmax shrank in the meantime drop out. Child order follows the direction
+/// of the first active lane.
+///
+static
+uint32_t
+traverse_packet(const bvh_t* bvh, ray3_packet_t* p, uint32_t mask, bool any_hit, tri3_hit_t* hits) {
+    packet_entry_t  stack[BVH_STACK_SIZE];
+    uint32_t        sp          = 0;
+    uint32_t        hit_mask    = 0;
+
+    if( bvh->node_count == 0 || mask == 0 ) return 0;
+
+    stack[sp].node  = 0;
+    stack[sp].mask  = mask;
+    ++sp;
+
+    while( sp ) {
+        --sp;
+        const bvh_node_t*   n   = &bvh->nodes[stack[sp].node];
+        uint32_t            m   = stack[sp].mask;
+        if( any_hit ) m &= ~hit_mask;
+
+        m   = intersect_box3_ray3_packet(n->bounds, p, m, NULL);
+        if( m == 0 ) continue;
+
+        if( n->count ) {
+            for( uint32_t i = n->first; i < n->first + n->count && m; ++i ) {
+                uint32_t    tri = bvh->prim_indices[i];
+                vec3_t      v0, v1, v2;
+                tri3_mesh_triangle(bvh->mesh, tri, &v0, &v1, &v2);
+
+                uint32_t    h   = ray3_packet_tri3_intersection(p, m, v0, v1, v2, tri, hits);
+                hit_mask    |= h;
+                if( any_hit ) {
+                    m   &= ~h;
+                    if( hit_mask == mask ) return hit_mask;
+                }
+            }
+        } else {
+            uint32_t    lane    = 0;
+            while( !(m & (1u << lane)) ) ++lane;
+
+            vec3_t      d       = vec3(p->dx[lane], p->dy[lane], p->dz[lane]);
+            vec3_t      c01     = vec3_sub(box3_center(bvh->nodes[n->first + 1].bounds),
+                                           box3_center(bvh->nodes[n->first].bounds));
+            uint32_t    near    = vec3_dot(d, c01) >= 0.0f ? n->first : n->first + 1;
+            uint32_t    far     = near == n->first ? n->first + 1 : n->first;
+
+            stack[sp].node  = far;
+            stack[sp].mask  = m;
+            ++sp;
+            stack[sp].node  = near;
+            stack[sp].mask  = m;
+            ++sp;
+        }
+    }
+
+    return hit_mask;
+}
+
+uint32_t
+bvh_ray3_packet_closest(const bvh_t* bvh, ray3_packet_t* p, uint32_t mask, tri3_hit_t* hits) {
+    return traverse_packet(bvh, p, mask, false, hits);
+}
+
+uint32_t
+bvh_ray3_packet_any(const bvh_t* bvh, ray3_packet_t* p, uint32_t mask) {
+    tri3_hit_t  hits[RAY3_PACKET_SIZE];
+    return traverse_packet(bvh, p, mask, true, hits);
+}
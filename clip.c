@@ -0,0 +1,233 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIP_PARALLEL_MIN   16384   /* smaller batches are not worth waking the threads */
+#define CLIP_CHUNK          1024    /* triangles per parallel chunk of the list clipper */
+
+static INLINE
+float
+plane_eval(plane_t p, vec3_t v) {
+    return p.a * v.x + p.b * v.y + p.c * v.z + p.d;
+}
+
+/*******************************************************************************
+** classification
+*******************************************************************************/
+void
+plane_distance_array(plane_t p, const vec3_t* points, uint32_t count, float* out) {
+#pragma omp parallel for if(count >= CLIP_PARALLEL_MIN)
+    for( int i = 0; i < (int)count; ++i ) {
+        out[i]  = plane_eval(p, points[i]);
+    }
+}
+
+uint32_t
+plane_classify_array(plane_t p, const vec3_t* points, uint32_t count, float epsilon, uint8_t* sides) {
+    uint32_t    front   = 0;
+    uint32_t    back    = 0;
+
+#pragma omp parallel for if(count >= CLIP_PARALLEL_MIN) reduction(+:front, back)
+    for( int i = 0; i < (int)count; ++i ) {
+        float   d   = plane_eval(p, points[i]);
+        uint8_t s   = d > epsilon ? PLANE_FRONT : (d < -epsilon ? PLANE_BACK : PLANE_ON);
+        if( sides ) sides[i] = s;
+        front   += s == PLANE_FRONT;
+        back    += s == PLANE_BACK;
+    }
+
+    uint32_t    on  = count - front - back;
+    return (front ? PLANE_FRONT : 0) | (back ? PLANE_BACK : 0) | (on ? PLANE_ON : 0);
+}
+
+/*******************************************************************************
+** Sutherland-Hodgman
+**
+** Vertices within epsilon of the plane count as on it: they are kept on both
+** sides and never produce an intersection of their own, so no sliver or
+** duplicate vertex appears. Intersections always interpolate from the front
+** vertex to the back one, so an edge shared by two polygons is cut at the
+** same point for both.
+*******************************************************************************/
+static INLINE
+vec3_t
+edge_cut(vec3_t a, float da, vec3_t b, float db) {
+    if( da < 0.0f ) {
+        vec3_t  t   = a;
+        float   dt  = da;
+        a   = b;
+        da  = db;
+        b   = t;
+        db  = dt;
+    }
+    return vec3_add(a, vec3_mulf(vec3_sub(b, a), da / (da - db)));
+}
+
+uint32_t
+clip_polygon_plane(const vec3_t* in, uint32_t count, plane_t p, float epsilon, vec3_t* out) {
+    if( count < 3 ) return 0;
+
+    uint32_t    n       = 0;
+    bool        behind  = false;
+    bool        front   = false;
+    vec3_t      a       = in[count - 1];
+    float       da      = plane_eval(p, a);
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        vec3_t  b   = in[i];
+        float   db  = plane_eval(p, b);
+
+        if( (da < -epsilon && db > epsilon) || (da > epsilon && db < -epsilon) )
+            out[n++]    = edge_cut(a, da, b, db);
+        if( db <= epsilon )
+            out[n++]    = b;
+        behind  |= db < -epsilon;
+        front   |= db > epsilon;
+
+        a   = b;
+        da  = db;
+    }
+
+    // only the vertices on the plane are left of a polygon in front of it
+    if( front && !behind ) return 0;
+    return n >= 3 ? n : 0;
+}
+
+uint32_t
+split_polygon_plane(const vec3_t* in, uint32_t count, plane_t p, float epsilon, vec3_t* front, uint32_t* front_count, vec3_t* back, uint32_t* back_count) {
+    uint32_t    nf      = 0;
+    uint32_t    nb      = 0;
+    uint32_t    sides   = 0;
+
+    if( count >= 3 ) {
+        vec3_t  a   = in[count - 1];
+        float   da  = plane_eval(p, a);
+
+        for( uint32_t i = 0; i < count; ++i ) {
+            vec3_t  b   = in[i];
+            float   db  = plane_eval(p, b);
+
+            if( (da < -epsilon && db > epsilon) || (da > epsilon && db < -epsilon) ) {
+                vec3_t  c   = edge_cut(a, da, b, db);
+                front[nf++] = c;
+                back[nb++]  = c;
+            }
+            if( db >= -epsilon )    front[nf++] = b;
+            if( db <= epsilon )     back[nb++]  = b;
+            sides   |= db > epsilon ? PLANE_FRONT : (db < -epsilon ? PLANE_BACK : PLANE_ON);
+
+            a   = b;
+            da  = db;
+        }
+    }
+
+    // a side only gets a polygon with a vertex strictly on it, except a
+    // polygon lying in the plane: it is on both, the returned sides tell
+    if( !(sides & PLANE_FRONT) && sides != PLANE_ON )   nf = 0;
+    if( !(sides & PLANE_BACK) && sides != PLANE_ON )    nb = 0;
+    *front_count    = nf >= 3 ? nf : 0;
+    *back_count     = nb >= 3 ? nb : 0;
+    return sides;
+}
+
+uint32_t
+clip_polygon_planes(const vec3_t* in, uint32_t count, const plane_t* planes, uint32_t plane_count, float epsilon, vec3_t* out, vec3_t* scratch) {
+    if( count < 3 ) return 0;
+    if( plane_count == 0 ) {
+        memcpy(out, in, sizeof(vec3_t) * count);
+        return count;
+    }
+
+    // ping-pong so that the last plane writes to out
+    const vec3_t*   src = in;
+    vec3_t*         dst = plane_count & 1 ? out : scratch;
+
+    for( uint32_t k = 0; k < plane_count && count; ++k ) {
+        count   = clip_polygon_plane(src, count, planes[k], epsilon, dst);
+        src     = dst;
+        dst     = dst == out ? scratch : out;
+    }
+
+    if( count && src != out ) memcpy(out, src, sizeof(vec3_t) * count);
+    return count;
+}
+
+/*******************************************************************************
+** triangle lists
+*******************************************************************************/
+/* clip one triangle and fan the result into out, returns the triangle count */
+static INLINE
+uint32_t
+clip_triangle(const vec3_t* tri, const plane_t* planes, uint32_t plane_count, float epsilon, vec3_t* out, vec3_t* poly, vec3_t* scratch) {
+    uint32_t    n   = clip_polygon_planes(tri, 3, planes, plane_count, epsilon, poly, scratch);
+    for( uint32_t i = 2; i < n; ++i ) {
+        out[(i - 2) * 3 + 0]    = poly[0];
+        out[(i - 2) * 3 + 1]    = poly[i - 1];
+        out[(i - 2) * 3 + 2]    = poly[i];
+    }
+    return n >= 3 ? n - 2 : 0;
+}
+
+uint32_t
+clip_tri3_list_planes(const vec3_t* tris, uint32_t tri_count, const plane_t* planes, uint32_t plane_count, float epsilon, vec3_t* out) {
+    uint32_t    per_tri = plane_count + 1;      /* a triangle clipped by k planes fans into at most k + 1 */
+    uint32_t    poly    = (3 + plane_count) * 2;
+    int         chunks  = (int)((tri_count + CLIP_CHUNK - 1) / CLIP_CHUNK);
+    uint32_t    total   = 0;
+
+    if( tri_count == 0 ) return 0;
+
+    // one scratch polygon pair and count per chunk, for the whole call
+    uint8_t*    mem     = (uint8_t*)malloc((sizeof(vec3_t) * poly + sizeof(uint32_t)) * (size_t)chunks);
+    if( !mem ) return 0;
+    vec3_t*     scratch = (vec3_t*)mem;
+    uint32_t*   counts  = (uint32_t*)(scratch + (size_t)poly * chunks);
+
+    // every chunk writes where its triangles would land if none were culled,
+    // the chunks are then packed in order
+#pragma omp parallel for schedule(dynamic) if(tri_count * 3 >= CLIP_PARALLEL_MIN)
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * CLIP_CHUNK;
+        uint32_t    end     = begin + CLIP_CHUNK < tri_count ? begin + CLIP_CHUNK : tri_count;
+        vec3_t*     dst     = &out[(size_t)begin * per_tri * 3];
+        vec3_t*     buf     = &scratch[(size_t)c * poly];
+        uint32_t    n       = 0;
+        for( uint32_t t = begin; t < end; ++t )
+            n   += clip_triangle(&tris[(size_t)t * 3], planes, plane_count, epsilon, &dst[n * 3], buf, buf + poly / 2);
+        counts[c]   = n;
+    }
+
+    for( int c = 0; c < chunks; ++c ) {
+        const vec3_t*   src = &out[(size_t)c * CLIP_CHUNK * per_tri * 3];
+        if( src != &out[(size_t)total * 3] ) memmove(&out[(size_t)total * 3], src, sizeof(vec3_t) * 3 * counts[c]);
+        total   += counts[c];
+    }
+
+    free(mem);
+    return total;
+}
+
+uint32_t
+clip_tri3_list_plane(const vec3_t* tris, uint32_t tri_count, plane_t p, float epsilon, vec3_t* out) {
+    return clip_tri3_list_planes(tris, tri_count, &p, 1, epsilon, out);
+}
@@ -0,0 +1,554 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <float.h>
+#include <math.h>
+
+#define GJK_MAX_ITERATIONS  64
+#define GJK_TOLERANCE       1e-6f   /* relative progress below which GJK stops */
+#define EPA_MAX_ITERATIONS  64
+#define EPA_MAX_VERTICES    (EPA_MAX_ITERATIONS + 4)
+#define EPA_MAX_FACES       (2 * EPA_MAX_VERTICES)
+#define EPA_TOLERANCE       1e-4f   /* relative gap between a face and the support in its normal */
+
+/*******************************************************************************
+** support functions
+*******************************************************************************/
+vec3_t
+convex3_support_point(const convex3_t* c, vec3_t dir) {
+    (void)dir;
+    return *(const vec3_t*)c->data;
+}
+
+vec3_t
+convex3_support_segment3(const convex3_t* c, vec3_t dir) {
+    const segment3_t*   s   = (const segment3_t*)c->data;
+    return vec3_dot(s->s, dir) >= vec3_dot(s->e, dir) ? s->s : s->e;
+}
+
+vec3_t
+convex3_support_box3(const convex3_t* c, vec3_t dir) {
+    const box3_t*   b   = (const box3_t*)c->data;
+    return vec3(dir.x >= 0.0f ? b->max.x : b->min.x,
+                dir.y >= 0.0f ? b->max.y : b->min.y,
+                dir.z >= 0.0f ? b->max.z : b->min.z);
+}
+
+vec3_t
+convex3_support_obb3(const convex3_t* c, vec3_t dir) {
+    const obb3_t*   o   = (const obb3_t*)c->data;
+    vec3_t          p   = o->center;
+    p   = vec3_add(p, vec3_mulf(o->axes.col[0], vec3_dot(dir, o->axes.col[0]) >= 0.0f ? o->extents.x : -o->extents.x));
+    p   = vec3_add(p, vec3_mulf(o->axes.col[1], vec3_dot(dir, o->axes.col[1]) >= 0.0f ? o->extents.y : -o->extents.y));
+    p   = vec3_add(p, vec3_mulf(o->axes.col[2], vec3_dot(dir, o->axes.col[2]) >= 0.0f ? o->extents.z : -o->extents.z));
+    return p;
+}
+
+vec3_t
+convex3_support_points(const convex3_t* c, vec3_t dir) {
+    const vec3_t*   p       = (const vec3_t*)c->data;
+    uint32_t        best    = 0;
+    float           best_d  = vec3_dot(p[0], dir);
+    for( uint32_t i = 1; i < c->count; ++i ) {
+        float   d   = vec3_dot(p[i], dir);
+        if( d > best_d ) {
+            best_d  = d;
+            best    = i;
+        }
+    }
+    return p[best];
+}
+
+/*******************************************************************************
+** simplex
+*******************************************************************************/
+typedef struct {
+    vec3_t      w;          /* a - b, point of the Minkowski difference */
+    vec3_t      a, b;       /* support points of the shapes */
+    vec3_t      d;          /* support direction for a */
+} vertex_t;
+
+typedef struct {
+    vertex_t    v[4];
+    float       l[4];       /* barycentric weights of the closest point to the origin */
+    uint32_t    count;
+} simplex_t;
+
+static INLINE
+vertex_t
+support(const convex3_t* a, const convex3_t* b, vec3_t d) {
+    vertex_t    r;
+    r.d = d;
+    r.a = a->support(a, d);
+    r.b = b->support(b, vec3_neg(d));
+    r.w = vec3_sub(r.a, r.b);
+    return r;
+}
+
+/* keep the vertices with a non zero weight */
+static
+void
+compact(simplex_t* s) {
+    uint32_t    n   = 0;
+    for( uint32_t i = 0; i < s->count; ++i ) {
+        if( s->l[i] > 0.0f ) {
+            s->v[n] = s->v[i];
+            s->l[n] = s->l[i];
+            ++n;
+        }
+    }
+    s->count    = n;
+}
+
+static
+vec3_t
+closest_segment(simplex_t* s) {
+    vec3_t  d   = vec3_sub(s->v[1].w, s->v[0].w);
+    float   dd  = vec3_dot(d, d);
+    float   t   = dd > 0.0f ? -vec3_dot(s->v[0].w, d) / dd : 0.0f;
+    t   = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+    vec3_t  p   = vec3_add(s->v[0].w, vec3_mulf(d, t));
+    s->l[0] = 1.0f - t;
+    s->l[1] = t;
+    compact(s);
+    return p;
+}
+
+static
+vec3_t
+closest_triangle(simplex_t* s) {
+    vec3_t  n   = vec3_cross(vec3_sub(s->v[1].w, s->v[0].w), vec3_sub(s->v[2].w, s->v[0].w));
+    if( vec3_dot(n, n) <= FLT_MIN ) {
+        // collinear: the closest of the three edges
+        simplex_t   best;
+        float       best_d  = INFINITY;
+        vec3_t      best_p  = s->v[0].w;
+        for( uint32_t i = 0; i < 3; ++i ) {
+            simplex_t   e;
+            e.v[0]  = s->v[i];
+            e.v[1]  = s->v[(i + 1) % 3];
+            e.count = 2;
+            vec3_t  p   = closest_segment(&e);
+            if( vec3_dot(p, p) < best_d ) {
+                best_d  = vec3_dot(p, p);
+                best_p  = p;
+                best    = e;
+            }
+        }
+        *s  = best;
+        return best_p;
+    }
+
+    vec2_t  uv;
+    vec3_t  p   = closest_point_on_tri3(s->v[0].w, s->v[1].w, s->v[2].w, vec3(0.0f, 0.0f, 0.0f), &uv);
+    s->l[0] = 1.0f - uv.x - uv.y;
+    s->l[1] = uv.x;
+    s->l[2] = uv.y;
+    compact(s);
+    return p;
+}
+
+///
+/// closest point of a tetrahedron to the origin: the origin is inside when it is on the
+/// inner side of the 4 faces, otherwise the closest point is on one of the faces it sees.
+///
+static
+bool
+closest_tetrahedron(simplex_t* s, vec3_t* v) {
+    static const uint32_t   faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+    simplex_t   best;
+    float       best_d  = INFINITY;
+    bool        outside = false;
+
+    // a (nearly) flat tetrahedron cannot enclose the origin, all its faces are candidates
+    vec3_t      e1      = vec3_sub(s->v[1].w, s->v[0].w);
+    vec3_t      e2      = vec3_sub(s->v[2].w, s->v[0].w);
+    vec3_t      e3      = vec3_sub(s->v[3].w, s->v[0].w);
+    float       vol     = vec3_dot(vec3_cross(e1, e2), e3);
+    bool        flat    = fabsf(vol) <= GJK_TOLERANCE * vec3_length(e1) * vec3_length(e2) * vec3_length(e3);
+
+    for( uint32_t f = 0; f < 4; ++f ) {
+        vec3_t  w0  = s->v[faces[f][0]].w;
+        vec3_t  n   = vec3_cross(vec3_sub(s->v[faces[f][1]].w, w0), vec3_sub(s->v[faces[f][2]].w, w0));
+        float   so  = vec3_dot(n, vec3_neg(w0));
+        float   sv  = vec3_dot(n, vec3_sub(s->v[faces[f][3]].w, w0));
+
+        // the origin and the opposite vertex on the same side
+        if( !flat && so * sv > 0.0f ) continue;
+
+        outside = true;
+        simplex_t   t;
+        t.v[0]  = s->v[faces[f][0]];
+        t.v[1]  = s->v[faces[f][1]];
+        t.v[2]  = s->v[faces[f][2]];
+        t.count = 3;
+        vec3_t  p   = closest_triangle(&t);
+        if( vec3_dot(p, p) < best_d ) {
+            best_d  = vec3_dot(p, p);
+            best    = t;
+            *v      = p;
+        }
+    }
+
+    if( !outside ) {
+        s->l[0] = s->l[1] = s->l[2] = s->l[3] = 0.25f;
+        return false;
+    }
+
+    *s  = best;
+    return true;
+}
+
+/* reduce the simplex to the smallest subset supporting its closest point v, false if it encloses the origin */
+static
+bool
+closest(simplex_t* s, vec3_t* v) {
+    switch( s->count ) {
+    case 1:
+        s->l[0] = 1.0f;
+        *v      = s->v[0].w;
+        return true;
+    case 2:
+        *v      = closest_segment(s);
+        return true;
+    case 3:
+        *v      = closest_triangle(s);
+        return true;
+    default:
+        return closest_tetrahedron(s, v);
+    }
+}
+
+static
+void
+witness(const simplex_t* s, vec3_t* pa, vec3_t* pb) {
+    *pa = vec3(0.0f, 0.0f, 0.0f);
+    *pb = vec3(0.0f, 0.0f, 0.0f);
+    for( uint32_t i = 0; i < s->count; ++i ) {
+        *pa = vec3_add(*pa, vec3_mulf(s->v[i].a, s->l[i]));
+        *pb = vec3_add(*pb, vec3_mulf(s->v[i].b, s->l[i]));
+    }
+}
+
+/*******************************************************************************
+** GJK
+*******************************************************************************/
+///
+/// GJK on the cores. Returns true with v the closest point of the Minkowski difference
+/// when the cores are separated, false when they intersect (the simplex then holds the
+/// last simplex around or touching the origin).
+///
+static
+bool
+gjk(const convex3_t* a, const convex3_t* b, gjk_cache_t* cache, simplex_t* s, vec3_t* v, uint32_t* iterations) {
+    s->count    = 0;
+    if( cache && cache->count ) {
+        for( uint32_t i = 0; i < cache->count && i < 4; ++i ) {
+            s->v[s->count++]    = support(a, b, cache->dirs[i]);
+        }
+    } else {
+        s->v[s->count++]    = support(a, b, vec3(1.0f, 0.0f, 0.0f));
+    }
+
+    bool        separated   = closest(s, v);
+    float       prev        = INFINITY;
+    uint32_t    it          = 0;
+
+    simplex_t   last;
+    vec3_t      last_v      = *v;
+
+    for( ; separated && it < GJK_MAX_ITERATIONS; ++it ) {
+        float   vv  = vec3_dot(*v, *v);
+        if( vv >= prev ) {
+            // numerical stall, keep the previous closer simplex
+            *s  = last;
+            *v  = last_v;
+            break;
+        }
+        if( vv <= FLT_MIN ) break;
+        prev    = vv;
+        last    = *s;
+        last_v  = *v;
+
+        vertex_t    w   = support(a, b, vec3_neg(*v));
+
+        // no progress towards the origin: v is the closest point
+        if( vv - vec3_dot(*v, w.w) <= GJK_TOLERANCE * vv ) break;
+
+        bool    duplicate   = false;
+        for( uint32_t i = 0; i < s->count; ++i ) {
+            duplicate   |= vec3_eq(s->v[i].w, w.w);
+        }
+        if( duplicate ) break;
+
+        s->v[s->count++]    = w;
+        separated   = closest(s, v);
+    }
+
+    if( cache ) {
+        cache->count    = s->count;
+        for( uint32_t i = 0; i < s->count; ++i ) {
+            cache->dirs[i]  = s->v[i].d;
+        }
+    }
+
+    *iterations = it;
+    return separated && vec3_dot(*v, *v) > FLT_MIN;
+}
+
+static
+void
+apply_radii(const convex3_t* a, const convex3_t* b, float core_distance, vec3_t normal, vec3_t pa, vec3_t pb, convex3_contact_t* out) {
+    out->normal     = normal;
+    out->point_a    = vec3_add(pa, vec3_mulf(normal, a->radius));
+    out->point_b    = vec3_sub(pb, vec3_mulf(normal, b->radius));
+    out->distance   = core_distance - a->radius - b->radius;
+}
+
+bool
+gjk_distance(const convex3_t* a, const convex3_t* b, gjk_cache_t* cache, convex3_contact_t* out) {
+    simplex_t   s;
+    vec3_t      v, pa, pb;
+
+    if( !gjk(a, b, cache, &s, &v, &out->iterations) ) {
+        out->distance   = 0.0f;
+        return false;
+    }
+
+    float   d   = vec3_length(v);
+    witness(&s, &pa, &pb);
+    apply_radii(a, b, d, vec3_divf(vec3_neg(v), d), pa, pb, out);
+    return out->distance > 0.0f;
+}
+
+/*******************************************************************************
+** EPA
+*******************************************************************************/
+typedef struct {
+    uint32_t    i[3];
+    vec3_t      n;          /* unit outward normal */
+    float       d;          /* distance of the plane to the origin */
+} face_t;
+
+static
+bool
+make_face(const vertex_t* verts, uint32_t i0, uint32_t i1, uint32_t i2, face_t* f) {
+    vec3_t  n   = vec3_cross(vec3_sub(verts[i1].w, verts[i0].w), vec3_sub(verts[i2].w, verts[i0].w));
+    float   len = vec3_length(n);
+    if( len <= FLT_MIN ) return false;
+
+    f->i[0] = i0;
+    f->i[1] = i1;
+    f->i[2] = i2;
+    f->n    = vec3_divf(n, len);
+    f->d    = vec3_dot(f->n, verts[i0].w);
+    return true;
+}
+
+///
+/// grow the GJK simplex into a tetrahedron enclosing the origin: missing vertices come from
+/// supports along the axes, then perpendicular to the segment, then along the triangle normal.
+///
+static
+bool
+blow_up(const convex3_t* a, const convex3_t* b, simplex_t* s) {
+    static const vec3_t axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+    if( s->count == 0 ) s->v[s->count++] = support(a, b, axes[0]);
+
+    for( uint32_t k = 0; s->count == 1 && k < 6; ++k ) {
+        vertex_t    w   = support(a, b, axes[k]);
+        if( !vec3_eq(w.w, s->v[0].w) ) s->v[s->count++] = w;
+    }
+
+    if( s->count == 2 ) {
+        vec3_t  d   = vec3_sub(s->v[1].w, s->v[0].w);
+        vec3_t  ad  = vec3(fabsf(d.x), fabsf(d.y), fabsf(d.z));
+        vec3_t  e   = ad.x <= ad.y && ad.x <= ad.z ? axes[0] : (ad.y <= ad.z ? axes[2] : axes[4]);
+        vec3_t  p   = vec3_normalize(vec3_cross(d, e));
+        vec3_t  q   = vec3_normalize(vec3_cross(d, p));
+        for( uint32_t k = 0; s->count == 2 && k < 6; ++k ) {
+            float       ang = (float)k * (2.0f * 3.14159265f / 6.0f);
+            vertex_t    w   = support(a, b, vec3_add(vec3_mulf(p, cosf(ang)), vec3_mulf(q, sinf(ang))));
+            vec3_t      c   = vec3_cross(d, vec3_sub(w.w, s->v[0].w));
+            if( vec3_dot(c, c) > FLT_MIN ) s->v[s->count++] = w;
+        }
+    }
+
+    if( s->count == 3 ) {
+        vec3_t      n   = vec3_cross(vec3_sub(s->v[1].w, s->v[0].w), vec3_sub(s->v[2].w, s->v[0].w));
+        vertex_t    w   = support(a, b, n);
+        if( fabsf(vec3_dot(n, vec3_sub(w.w, s->v[0].w))) <= FLT_MIN ) w = support(a, b, vec3_neg(n));
+        if( fabsf(vec3_dot(n, vec3_sub(w.w, s->v[0].w))) <= FLT_MIN ) return false;
+        s->v[s->count++]    = w;
+    }
+
+    return s->count == 4;
+}
+
+///
+/// expand the tetrahedron around the origin towards the closest face of the Minkowski
+/// difference. Returns false when the initial tetrahedron has a degenerate face.
+///
+static
+bool
+epa(const convex3_t* a, const convex3_t* b, simplex_t* s, face_t* result, vertex_t* verts, uint32_t* iterations) {
+    static const uint32_t   tet[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+    face_t      faces[EPA_MAX_FACES];
+    uint32_t    edges[EPA_MAX_FACES * 3][2];
+    uint32_t    face_count  = 0;
+    uint32_t    vert_count  = 4;
+    uint32_t    it          = 0;
+
+    for( uint32_t i = 0; i < 4; ++i ) verts[i] = s->v[i];
+
+    for( uint32_t f = 0; f < 4; ++f ) {
+        face_t  face;
+        if( !make_face(verts, tet[f][0], tet[f][1], tet[f][2], &face) ) return false;
+        if( vec3_dot(face.n, vec3_sub(verts[tet[f][3]].w, verts[tet[f][0]].w)) > 0.0f ) {
+            // points towards the opposite vertex, flip the winding
+            make_face(verts, tet[f][0], tet[f][2], tet[f][1], &face);
+        }
+        faces[face_count++] = face;
+    }
+
+    for( ;; ++it ) {
+        uint32_t    best    = 0;
+        for( uint32_t f = 1; f < face_count; ++f ) {
+            if( faces[f].d < faces[best].d ) best = f;
+        }
+        *result = faces[best];
+
+        if( it >= EPA_MAX_ITERATIONS || vert_count == EPA_MAX_VERTICES ) break;
+
+        vertex_t    w   = support(a, b, faces[best].n);
+        float       gap = vec3_dot(w.w, faces[best].n) - faces[best].d;
+        if( gap <= EPA_TOLERANCE * (faces[best].d > 1.0f ? faces[best].d : 1.0f) ) break;
+
+        // remove the faces seen from w, their unshared edges form the horizon
+        uint32_t    edge_count  = 0;
+        for( uint32_t f = 0; f < face_count; ) {
+            if( vec3_dot(faces[f].n, vec3_sub(w.w, verts[faces[f].i[0]].w)) <= 0.0f ) {
+                ++f;
+                continue;
+            }
+
+            for( uint32_t k = 0; k < 3; ++k ) {
+                uint32_t    e0  = faces[f].i[k];
+                uint32_t    e1  = faces[f].i[(k + 1) % 3];
+                uint32_t    j   = 0;
+                while( j < edge_count && !(edges[j][0] == e1 && edges[j][1] == e0) ) ++j;
+                if( j < edge_count ) {
+                    edges[j][0] = edges[edge_count - 1][0];
+                    edges[j][1] = edges[edge_count - 1][1];
+                    --edge_count;
+                } else {
+                    edges[edge_count][0]    = e0;
+                    edges[edge_count][1]    = e1;
+                    ++edge_count;
+                }
+            }
+            faces[f]    = faces[--face_count];
+        }
+
+        if( face_count + edge_count > EPA_MAX_FACES ) break;
+
+        verts[vert_count]   = w;
+        for( uint32_t e = 0; e < edge_count; ++e ) {
+            face_t  face;
+            if( make_face(verts, edges[e][0], edges[e][1], vert_count, &face) ) faces[face_count++] = face;
+        }
+        ++vert_count;
+
+        if( face_count == 0 ) break;
+    }
+
+    *iterations += it;
+    return true;
+}
+
+///
+/// contact of cores whose Minkowski difference is flat, a segment or a point around the
+/// origin: the normal is the normal of the plane, or any direction perpendicular to the
+/// segment, on the side with the smaller depth. The witness points come from core, the
+/// GJK simplex touching the origin.
+///
+static
+void
+flat_contact(const convex3_t* a, const convex3_t* b, const simplex_t* core, const simplex_t* s, convex3_contact_t* out) {
+    vec3_t  n   = vec3(0.0f, 1.0f, 0.0f);
+    vec3_t  d   = s->count >= 2 ? vec3_sub(s->v[1].w, s->v[0].w) : vec3(0.0f, 0.0f, 0.0f);
+    vec3_t  c   = s->count >= 3 ? vec3_cross(d, vec3_sub(s->v[2].w, s->v[0].w)) : vec3(0.0f, 0.0f, 0.0f);
+
+    if( vec3_dot(c, c) > FLT_MIN ) {
+        n   = vec3_normalize(c);
+    } else if( vec3_dot(d, d) > FLT_MIN ) {
+        vec3_t  ad  = vec3(fabsf(d.x), fabsf(d.y), fabsf(d.z));
+        vec3_t  e   = ad.x <= ad.y && ad.x <= ad.z ? vec3(1.0f, 0.0f, 0.0f) : (ad.y <= ad.z ? vec3(0.0f, 1.0f, 0.0f) : vec3(0.0f, 0.0f, 1.0f));
+        n   = vec3_normalize(vec3_cross(d, e));
+    }
+
+    float   dp  = vec3_dot(support(a, b, n).w, n);
+    float   dn  = -vec3_dot(support(a, b, vec3_neg(n)).w, n);
+    float   depth   = dp;
+    if( dn < dp ) {
+        n       = vec3_neg(n);
+        depth   = dn;
+    }
+
+    vec3_t  pa, pb;
+    witness(core, &pa, &pb);
+    pb  = vec3_sub(pa, vec3_mulf(n, depth));
+    apply_radii(a, b, -depth, n, pa, pb, out);
+}
+
+bool
+gjk_epa(const convex3_t* a, const convex3_t* b, gjk_cache_t* cache, convex3_contact_t* out) {
+    simplex_t   s;
+    vec3_t      v, pa, pb;
+
+    if( gjk(a, b, cache, &s, &v, &out->iterations) ) {
+        float   d   = vec3_length(v);
+        witness(&s, &pa, &pb);
+        apply_radii(a, b, d, vec3_divf(vec3_neg(v), d), pa, pb, out);
+        return out->distance <= 0.0f;
+    }
+
+    // cores intersect
+    simplex_t   core    = s;
+    vertex_t    verts[EPA_MAX_VERTICES];
+    face_t      f;
+    if( !blow_up(a, b, &s) || !epa(a, b, &s, &f, verts, &out->iterations) ) {
+        flat_contact(a, b, &core, &s, out);
+        return true;
+    }
+
+    // barycentrics of the origin projected on the closest face
+    vec2_t      uv;
+    closest_point_on_tri3(verts[f.i[0]].w, verts[f.i[1]].w, verts[f.i[2]].w, vec3_mulf(f.n, f.d), &uv);
+
+    float       l0  = 1.0f - uv.x - uv.y;
+    pa  = vec3_add(vec3_mulf(verts[f.i[0]].a, l0), vec3_add(vec3_mulf(verts[f.i[1]].a, uv.x), vec3_mulf(verts[f.i[2]].a, uv.y)));
+    pb  = vec3_add(vec3_mulf(verts[f.i[0]].b, l0), vec3_add(vec3_mulf(verts[f.i[1]].b, uv.x), vec3_mulf(verts[f.i[2]].b, uv.y)));
+    apply_radii(a, b, -f.d, f.n, pa, pb, out);
+    return true;
+}
@@ -0,0 +1,176 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+static
+bool
+reserve(hash_grid_t* g, uint32_t capacity) {
+    if( capacity <= g->capacity ) return true;
+
+    uint32_t*   indices     = (uint32_t*)realloc(g->indices, sizeof(uint32_t) * capacity);
+    if( indices ) g->indices = indices;
+    vec3_t*     positions   = (vec3_t*)realloc(g->positions, sizeof(vec3_t) * capacity);
+    if( positions ) g->positions = positions;
+    ivec3_t*    cells       = (ivec3_t*)realloc(g->cells, sizeof(ivec3_t) * capacity);
+    if( cells ) g->cells = cells;
+    uint32_t*   keys        = (uint32_t*)realloc(g->keys, sizeof(uint32_t) * capacity);
+    if( keys ) g->keys = keys;
+
+    if( !indices || !positions || !cells || !keys ) return false;
+    g->capacity = capacity;
+    return true;
+}
+
+bool
+hash_grid_init(hash_grid_t* g, float cell_size, uint32_t table_size, uint32_t capacity) {
+    memset(g, 0, sizeof(hash_grid_t));
+
+    uint32_t    size    = 1;
+    while( size < table_size && size < 0x80000000u ) size <<= 1;
+
+    g->cell_size        = cell_size;
+    g->inv_cell_size    = 1.0f / cell_size;
+    g->table_size       = size;
+    g->bucket_start     = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+    if( !g->bucket_start || !reserve(g, capacity ? capacity : 64) ) {
+        hash_grid_release(g);
+        return false;
+    }
+    return true;
+}
+
+void
+hash_grid_release(hash_grid_t* g) {
+    free(g->bucket_start);
+    free(g->indices);
+    free(g->positions);
+    free(g->cells);
+    free(g->keys);
+    memset(g, 0, sizeof(hash_grid_t));
+}
+
+bool
+hash_grid_build(hash_grid_t* g, const vec3_t* positions, uint32_t count) {
+    if( !reserve(g, count) ) return false;
+    g->count    = count;
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        g->keys[i]  = hash_grid_bucket(g, hash_grid_cell(g, positions[i]));
+    }
+
+    // counting sort on the bucket
+    memset(g->bucket_start, 0, sizeof(uint32_t) * (g->table_size + 1));
+    for( uint32_t i = 0; i < count; ++i ) {
+        g->bucket_start[g->keys[i]]++;
+    }
+
+    uint32_t    sum = 0;
+    for( uint32_t b = 0; b < g->table_size; ++b ) {
+        uint32_t    n   = g->bucket_start[b];
+        g->bucket_start[b]  = sum;
+        sum     += n;
+    }
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        uint32_t    dst = g->bucket_start[g->keys[i]]++;
+        g->indices[dst]     = i;
+        g->positions[dst]   = positions[i];
+        g->cells[dst]       = hash_grid_cell(g, positions[i]);
+    }
+
+    // the scatter moved every start to the start of the next bucket
+    memmove(g->bucket_start + 1, g->bucket_start, sizeof(uint32_t) * g->table_size);
+    g->bucket_start[0]  = 0;
+    return true;
+}
+
+uint32_t
+hash_grid_query_sphere(const hash_grid_t* g, vec3_t center, float radius, uint32_t* out, uint32_t max_out) {
+    ivec3_t     lo      = hash_grid_cell(g, vec3_sub(center, vec3(radius, radius, radius)));
+    ivec3_t     hi      = hash_grid_cell(g, vec3_add(center, vec3(radius, radius, radius)));
+    float       r2      = radius * radius;
+    uint32_t    found   = 0;
+
+    for( int z = lo.z; z <= hi.z; ++z ) {
+        for( int y = lo.y; y <= hi.y; ++y ) {
+            for( int x = lo.x; x <= hi.x; ++x ) {
+                ivec3_t     c   = ivec3(x, y, z);
+                uint32_t    b   = hash_grid_bucket(g, c);
+                for( uint32_t i = g->bucket_start[b]; i < g->bucket_start[b + 1]; ++i ) {
+                    // buckets are shared by colliding cells, the cell check also avoids duplicates
+                    if( !ivec3_eq(g->cells[i], c) ) continue;
+                    vec3_t  d   = vec3_sub(g->positions[i], center);
+                    if( vec3_dot(d, d) <= r2 ) {
+                        if( found < max_out ) out[found] = g->indices[i];
+                        ++found;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+///
+/// every point scans the cells around it and keeps the neighbours that come after
+/// it in the sorted order, so each pair is reported exactly once
+///
+uint32_t
+hash_grid_pairs(const hash_grid_t* g, float radius, uint32_t* pairs, uint32_t max_pairs) {
+    float       r2      = radius * radius;
+    int         k       = (int)ceilf(radius * g->inv_cell_size);
+    uint32_t    found   = 0;
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for( int i = 0; i < (int)g->count; ++i ) {
+        vec3_t      p   = g->positions[i];
+        ivec3_t     pc  = g->cells[i];
+
+        for( int z = pc.z - k; z <= pc.z + k; ++z ) {
+            for( int y = pc.y - k; y <= pc.y + k; ++y ) {
+                for( int x = pc.x - k; x <= pc.x + k; ++x ) {
+                    ivec3_t     c   = ivec3(x, y, z);
+                    uint32_t    b   = hash_grid_bucket(g, c);
+                    uint32_t    end = g->bucket_start[b + 1];
+                    uint32_t    j   = g->bucket_start[b] > (uint32_t)i + 1 ? g->bucket_start[b] : (uint32_t)i + 1;
+                    for( ; j < end; ++j ) {
+                        if( !ivec3_eq(g->cells[j], c) ) continue;
+                        vec3_t  d   = vec3_sub(g->positions[j], p);
+                        if( vec3_dot(d, d) > r2 ) continue;
+
+                        uint32_t    slot;
+#pragma omp atomic capture
+                        slot = found++;
+                        if( slot < max_pairs ) {
+                            pairs[2 * slot]     = g->indices[i];
+                            pairs[2 * slot + 1] = g->indices[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,624 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HULL_NONE       0xFFFFFFFFu
+#define HULL_BLOCK      64          /* points per block of the batched containment test */
+
+/*******************************************************************************
+** quickhull working set: a closed triangle mesh with edge adjacency, every
+** face owning the list of the points above it
+*******************************************************************************/
+typedef struct {
+    uint32_t    v[3];
+    uint32_t    adj[3];     /* face across the edge v[i] -> v[i + 1] */
+    vec3_t      n;
+    float       d;
+    uint32_t    outside;    /* head of the list of points above the face */
+    uint32_t    furthest;
+    float       furthest_d;
+    uint32_t    stamp;      /* horizon search visit */
+    bool        visible;
+    bool        alive;
+} hull_face_t;
+
+typedef struct {
+    uint32_t*   data;
+    uint32_t    count;
+    uint32_t    capacity;
+} index_list_t;
+
+typedef struct {
+    const vec3_t*   input;
+    vec3_t*         points;     /* input relative to the center of its bounds */
+    vec3_t          center;
+    uint32_t        count;
+    float           eps;
+    uint32_t*       next;       /* outside list links, one per point */
+    uint32_t*       link;       /* per point scratch: new face of a horizon vertex, boundary successor */
+    hull_face_t*    faces;
+    uint32_t        face_count;
+    uint32_t        face_capacity;
+    uint32_t        stamp;
+    index_list_t    stack;
+    index_list_t    visible;
+    index_list_t    horizon;    /* a, b, hidden face triples */
+} hull_builder_t;
+
+typedef struct {
+    float       area;
+    uint32_t    face;
+} face_area_t;
+
+static
+bool
+list_push(index_list_t* l, uint32_t v) {
+    if( l->count == l->capacity ) {
+        uint32_t    capacity    = l->capacity ? l->capacity * 2 : 64;
+        uint32_t*   data        = (uint32_t*)realloc(l->data, sizeof(uint32_t) * capacity);
+        if( !data ) return false;
+        l->data     = data;
+        l->capacity = capacity;
+    }
+    l->data[l->count++] = v;
+    return true;
+}
+
+static INLINE
+float
+face_distance(const hull_face_t* f, vec3_t p) {
+    return vec3_dot(f->n, p) + f->d;
+}
+
+static
+uint32_t
+add_face(hull_builder_t* hb, uint32_t a, uint32_t b, uint32_t c) {
+    if( hb->face_count == hb->face_capacity ) {
+        uint32_t        capacity    = hb->face_capacity ? hb->face_capacity * 2 : 64;
+        hull_face_t*    faces       = (hull_face_t*)realloc(hb->faces, sizeof(hull_face_t) * capacity);
+        if( !faces ) return HULL_NONE;
+        hb->faces           = faces;
+        hb->face_capacity   = capacity;
+    }
+
+    // double precision: the normal of a sliver triangle is ill conditioned in
+    // floats and a tilted plane breaks the visibility tests of later points
+    hull_face_t*    f   = &hb->faces[hb->face_count];
+    vec3_t          p0  = hb->points[a];
+    vec3_t          p1  = hb->points[b];
+    vec3_t          p2  = hb->points[c];
+    dvec3_t         d0  = dvec3(p0.x, p0.y, p0.z);
+    dvec3_t         d1  = dvec3(p1.x, p1.y, p1.z);
+    dvec3_t         d2  = dvec3(p2.x, p2.y, p2.z);
+    dvec3_t         n   = dvec3_cross(dvec3_sub(d1, d0), dvec3_sub(d2, d0));
+    double          l   = dvec3_length(n);
+
+    memset(f, 0, sizeof(hull_face_t));
+    f->v[0]         = a;
+    f->v[1]         = b;
+    f->v[2]         = c;
+    f->adj[0]       = f->adj[1] = f->adj[2] = HULL_NONE;
+    f->outside      = HULL_NONE;
+    f->furthest     = HULL_NONE;
+    f->alive        = true;
+    // degenerate faces get the plane of their neighbor once it is known
+    if( l > 0.0 ) {
+        n       = dvec3_divf(n, l);
+        f->n    = vec3((float)n.x, (float)n.y, (float)n.z);
+        f->d    = (float)(-dvec3_dot(n, dvec3_add(dvec3_add(d0, d1), d2)) / 3.0);
+    }
+    return hb->face_count++;
+}
+
+/* move a point to the first face of the range it is above, points inside are dropped */
+static
+void
+assign_point(hull_builder_t* hb, uint32_t pt, uint32_t first, uint32_t last) {
+    vec3_t  p   = hb->points[pt];
+    for( uint32_t i = first; i < last; ++i ) {
+        hull_face_t*    f   = &hb->faces[i];
+        float           d   = face_distance(f, p);
+        if( d > hb->eps ) {
+            hb->next[pt]    = f->outside;
+            f->outside      = pt;
+            if( f->furthest == HULL_NONE || d > f->furthest_d ) {
+                f->furthest     = pt;
+                f->furthest_d   = d;
+            }
+            return;
+        }
+    }
+}
+
+static INLINE
+uint32_t
+edge_index(const hull_face_t* f, uint32_t a) {
+    return f->v[0] == a ? 0 : (f->v[1] == a ? 1 : 2);
+}
+
+/* initial tetrahedron from the extreme points, false if the points are (nearly) flat */
+static
+bool
+init_simplex(hull_builder_t* hb) {
+    const vec3_t*   p       = hb->points;
+    uint32_t        ext[6]  = { 0, 0, 0, 0, 0, 0 };
+
+    for( uint32_t i = 1; i < hb->count; ++i ) {
+        for( uint32_t a = 0; a < 3; ++a ) {
+            if( vec3_axis(p[i], a) < vec3_axis(p[ext[a * 2]], a) )      ext[a * 2]      = i;
+            if( vec3_axis(p[i], a) > vec3_axis(p[ext[a * 2 + 1]], a) )  ext[a * 2 + 1]  = i;
+        }
+    }
+
+    uint32_t    v[4]    = { 0, 0, 0, 0 };
+    float       best    = -1.0f;
+    for( uint32_t i = 0; i < 6; ++i ) {
+        for( uint32_t j = i + 1; j < 6; ++j ) {
+            vec3_t  e   = vec3_sub(p[ext[j]], p[ext[i]]);
+            float   d   = vec3_dot(e, e);
+            if( d > best ) {
+                best    = d;
+                v[0]    = ext[i];
+                v[1]    = ext[j];
+            }
+        }
+    }
+
+    // farthest from the line, then farthest from the plane
+    vec3_t  dir = vec3_sub(p[v[1]], p[v[0]]);
+    best    = -1.0f;
+    for( uint32_t i = 0; i < hb->count; ++i ) {
+        vec3_t  c   = vec3_cross(dir, vec3_sub(p[i], p[v[0]]));
+        float   d   = vec3_dot(c, c);
+        if( d > best ) {
+            best    = d;
+            v[2]    = i;
+        }
+    }
+    if( sqrtf(best) <= hb->eps * vec3_length(dir) ) return false;
+
+    vec3_t  n   = vec3_normalize(vec3_cross(dir, vec3_sub(p[v[2]], p[v[0]])));
+    best    = -1.0f;
+    for( uint32_t i = 0; i < hb->count; ++i ) {
+        float   d   = fabsf(vec3_dot(n, vec3_sub(p[i], p[v[0]])));
+        if( d > best ) {
+            best    = d;
+            v[3]    = i;
+        }
+    }
+    if( best <= hb->eps ) return false;
+
+    // wind every face outward, away from the opposite vertex
+    static const uint32_t   tris[4][4]  = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 }, { 2, 3, 0, 1 } };
+    for( uint32_t f = 0; f < 4; ++f ) {
+        uint32_t    a   = v[tris[f][0]];
+        uint32_t    b   = v[tris[f][1]];
+        uint32_t    c   = v[tris[f][2]];
+        vec3_t      fn  = vec3_cross(vec3_sub(p[b], p[a]), vec3_sub(p[c], p[a]));
+        bool        out = vec3_dot(fn, vec3_sub(p[v[tris[f][3]]], p[a])) < 0.0f;
+        if( add_face(hb, a, out ? b : c, out ? c : b) == HULL_NONE ) return false;
+    }
+
+    // adjacency: the face across a -> b has the edge b -> a
+    for( uint32_t f = 0; f < 4; ++f ) {
+        hull_face_t*    fa  = &hb->faces[f];
+        for( uint32_t e = 0; e < 3; ++e ) {
+            for( uint32_t g = 0; g < 4; ++g ) {
+                if( g == f ) continue;
+                uint32_t    j   = edge_index(&hb->faces[g], fa->v[(e + 1) % 3]);
+                if( hb->faces[g].v[j] == fa->v[(e + 1) % 3] && hb->faces[g].v[(j + 1) % 3] == fa->v[e] ) fa->adj[e] = g;
+            }
+        }
+    }
+
+    for( uint32_t i = 0; i < hb->count; ++i ) {
+        if( i != v[0] && i != v[1] && i != v[2] && i != v[3] )
+            assign_point(hb, i, 0, 4);
+    }
+    return true;
+}
+
+/* add the furthest point of a face to the hull, false on allocation failure or a broken horizon */
+static
+bool
+add_point(hull_builder_t* hb, uint32_t face) {
+    uint32_t    eye     = hb->faces[face].furthest;
+    vec3_t      e       = hb->points[eye];
+
+    // flood the faces the eye sees, the horizon is the boundary of that region.
+    // Faces the eye is barely in front of are removed too: kept, they would
+    // meet the thin new face on their edge with a fold much deeper than the
+    // tolerance.
+    ++hb->stamp;
+    hb->stack.count     = 0;
+    hb->visible.count   = 0;
+    hb->horizon.count   = 0;
+    hb->faces[face].stamp   = hb->stamp;
+    hb->faces[face].visible = true;
+    if( !list_push(&hb->stack, face) ) return false;
+
+    while( hb->stack.count ) {
+        uint32_t    fi  = hb->stack.data[--hb->stack.count];
+        if( !list_push(&hb->visible, fi) ) return false;
+        for( uint32_t i = 0; i < 3; ++i ) {
+            hull_face_t*    g   = &hb->faces[hb->faces[fi].adj[i]];
+            if( g->stamp != hb->stamp ) {
+                g->stamp    = hb->stamp;
+                g->visible  = face_distance(g, e) > 0.0f;
+                if( g->visible && !list_push(&hb->stack, hb->faces[fi].adj[i]) ) return false;
+            }
+            if( !g->visible ) {
+                if( !list_push(&hb->horizon, hb->faces[fi].v[i]) ||
+                    !list_push(&hb->horizon, hb->faces[fi].v[(i + 1) % 3]) ||
+                    !list_push(&hb->horizon, hb->faces[fi].adj[i]) ) return false;
+            }
+        }
+    }
+
+    // a cone of new faces from the horizon to the eye
+    uint32_t    first   = hb->face_count;
+    for( uint32_t h = 0; h < hb->horizon.count; h += 3 ) {
+        uint32_t    a   = hb->horizon.data[h];
+        uint32_t    b   = hb->horizon.data[h + 1];
+        uint32_t    g   = hb->horizon.data[h + 2];
+        uint32_t    nf  = add_face(hb, a, b, eye);
+        if( nf == HULL_NONE ) return false;
+
+        hull_face_t*    f   = &hb->faces[nf];
+        hull_face_t*    gf  = &hb->faces[g];
+        if( vec3_dot(f->n, f->n) == 0.0f ) {
+            f->n    = gf->n;
+            f->d    = gf->d;
+        }
+        f->adj[0]   = g;
+        gf->adj[edge_index(gf, b)]  = nf;
+
+        // each horizon vertex starts exactly one horizon edge
+        uint32_t    prev    = hb->link[a];
+        if( prev != HULL_NONE && prev >= first && prev < nf && hb->faces[prev].v[0] == a ) return false;
+        hb->link[a] = nf;
+    }
+
+    for( uint32_t nf = first; nf < hb->face_count; ++nf ) {
+        uint32_t    m   = hb->link[hb->faces[nf].v[1]];
+        if( m == HULL_NONE || m < first || m >= hb->face_count || hb->faces[m].v[0] != hb->faces[nf].v[1] ) return false;
+        hb->faces[nf].adj[1]    = m;
+        hb->faces[m].adj[2]     = nf;
+    }
+
+    // the points of the removed faces go to the new ones
+    for( uint32_t i = 0; i < hb->visible.count; ++i ) {
+        hull_face_t*    f   = &hb->faces[hb->visible.data[i]];
+        uint32_t        pt  = f->outside;
+        f->alive    = false;
+        f->outside  = HULL_NONE;
+        while( pt != HULL_NONE ) {
+            uint32_t    next    = hb->next[pt];
+            if( pt != eye ) assign_point(hb, pt, first, hb->face_count);
+            pt  = next;
+        }
+    }
+    return true;
+}
+
+static
+int
+compare_areas(const void* a, const void* b) {
+    float   aa  = ((const face_area_t*)a)->area;
+    float   ab  = ((const face_area_t*)b)->area;
+    return (aa < ab) - (aa > ab);
+}
+
+/* drop polygon vertices that lie on the segment between their neighbors */
+static
+uint32_t
+remove_collinear(const vec3_t* p, uint32_t* poly, uint32_t count, float eps) {
+    bool    changed = true;
+    while( changed && count > 3 ) {
+        changed = false;
+        for( uint32_t i = 0; i < count && count > 3; ++i ) {
+            vec3_t  a   = p[poly[(i + count - 1) % count]];
+            vec3_t  b   = p[poly[i]];
+            vec3_t  c   = p[poly[(i + 1) % count]];
+            vec3_t  ac  = vec3_sub(c, a);
+            float   l   = vec3_length(ac);
+            if( vec3_length(vec3_cross(ac, vec3_sub(b, a))) <= eps * l ) {
+                memmove(&poly[i], &poly[i + 1], sizeof(uint32_t) * (count - i - 1));
+                --count;
+                changed = true;
+            }
+        }
+    }
+    return count;
+}
+
+/*
+ * merge the triangles into planar polygons: regions grow from the largest
+ * triangles and only accept neighbors whose vertices are all within the
+ * tolerance of the seed plane, so slowly curving surfaces do not collapse
+ * into one face
+ */
+static
+bool
+extract_faces(hull_builder_t* hb, convex_hull_t* h) {
+    const vec3_t*   p           = hb->points;
+    uint32_t        tri_count   = 0;
+    face_area_t*    order       = (face_area_t*)malloc(sizeof(face_area_t) * hb->face_count);
+    uint32_t*       region      = (uint32_t*)malloc(sizeof(uint32_t) * hb->face_count);
+    index_list_t    members     = { NULL, 0, 0 };
+    bool            ok          = order && region;
+
+    for( uint32_t f = 0; ok && f < hb->face_count; ++f ) {
+        region[f]   = HULL_NONE;
+        if( !hb->faces[f].alive ) continue;
+        const hull_face_t*  hf  = &hb->faces[f];
+        order[tri_count].area   = vec3_length(vec3_cross(vec3_sub(p[hf->v[1]], p[hf->v[0]]), vec3_sub(p[hf->v[2]], p[hf->v[0]])));
+        order[tri_count].face   = f;
+        ++tri_count;
+    }
+
+    if( ok ) {
+        qsort(order, tri_count, sizeof(face_area_t), compare_areas);
+        h->indices      = (uint32_t*)malloc(sizeof(uint32_t) * tri_count * 3);
+        h->face_first   = (uint32_t*)malloc(sizeof(uint32_t) * (tri_count + 1));
+        h->planes       = (plane_t*)malloc(sizeof(plane_t) * tri_count);
+        ok  = h->indices && h->face_first && h->planes;
+    }
+
+    uint32_t    region_count    = 0;
+    for( uint32_t s = 0; ok && s < tri_count; ++s ) {
+        uint32_t            seed    = order[s].face;
+        if( region[seed] != HULL_NONE ) continue;
+
+        const hull_face_t*  sf      = &hb->faces[seed];
+        uint32_t            r       = region_count++;
+
+        members.count   = 0;
+        region[seed]    = r;
+        ok  = list_push(&members, seed);
+        for( uint32_t m = 0; ok && m < members.count; ++m ) {
+            const hull_face_t*  f   = &hb->faces[members.data[m]];
+            for( uint32_t i = 0; ok && i < 3; ++i ) {
+                uint32_t            gi  = f->adj[i];
+                const hull_face_t*  g   = &hb->faces[gi];
+                if( region[gi] != HULL_NONE || vec3_dot(g->n, sf->n) <= 0.0f ) continue;
+                if( fabsf(face_distance(sf, p[g->v[0]])) > hb->eps ||
+                    fabsf(face_distance(sf, p[g->v[1]])) > hb->eps ||
+                    fabsf(face_distance(sf, p[g->v[2]])) > hb->eps ) continue;
+                region[gi]  = r;
+                ok  = list_push(&members, gi);
+            }
+        }
+        if( !ok ) break;
+
+        // the boundary edges of a simple region chain into its polygon
+        uint32_t    edges   = 0;
+        uint32_t    start   = HULL_NONE;
+        for( uint32_t m = 0; m < members.count; ++m ) {
+            const hull_face_t*  f   = &hb->faces[members.data[m]];
+            for( uint32_t i = 0; i < 3; ++i ) {
+                if( region[f->adj[i]] == r ) continue;
+                hb->link[f->v[i]]   = f->v[(i + 1) % 3];
+                start   = f->v[i];
+                ++edges;
+            }
+        }
+
+        uint32_t*   poly    = &h->indices[h->index_count];
+        uint32_t    count   = 0;
+        uint32_t    v       = start;
+        do {
+            poly[count++]   = v;
+            v   = hb->link[v];
+        } while( v != start && count < edges );
+
+        if( v != start || count != edges || count < 3 ) {
+            // not a simple polygon, keep the triangles of the region
+            for( uint32_t m = 0; m < members.count; ++m ) {
+                const hull_face_t*  f   = &hb->faces[members.data[m]];
+                h->face_first[h->face_count]    = h->index_count;
+                h->planes[h->face_count]        = plane(f->n.x, f->n.y, f->n.z, f->d);
+                memcpy(&h->indices[h->index_count], f->v, sizeof(uint32_t) * 3);
+                h->index_count  += 3;
+                ++h->face_count;
+            }
+            continue;
+        }
+
+        count   = remove_collinear(p, poly, count, hb->eps);
+
+        // supporting plane along the seed normal, the best conditioned one of the region
+        vec3_t  n       = sf->n;
+        float   dmax    = -INFINITY;
+        for( uint32_t i = 0; i < count; ++i )
+            dmax    = fmaxf(dmax, vec3_dot(n, p[poly[i]]));
+
+        h->face_first[h->face_count]    = h->index_count;
+        h->planes[h->face_count]        = plane(n.x, n.y, n.z, -dmax);
+        h->index_count  += count;
+        ++h->face_count;
+    }
+
+    if( ok ) h->face_first[h->face_count] = h->index_count;
+
+    free(members.data);
+    free(region);
+    free(order);
+    return ok;
+}
+
+/* keep the referenced points only and renumber the faces */
+static
+bool
+extract_vertices(hull_builder_t* hb, convex_hull_t* h) {
+    uint32_t*   remap   = hb->link;
+    uint32_t    count   = 0;
+
+    memset(remap, 0xFF, sizeof(uint32_t) * hb->count);
+    for( uint32_t i = 0; i < h->index_count; ++i ) {
+        if( remap[h->indices[i]] == HULL_NONE ) remap[h->indices[i]] = count++;
+    }
+
+    h->vertices = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    if( !h->vertices ) return false;
+
+    for( uint32_t i = 0; i < hb->count; ++i ) {
+        if( remap[i] != HULL_NONE ) h->vertices[remap[i]] = hb->input[i];
+    }
+    for( uint32_t i = 0; i < h->index_count; ++i )
+        h->indices[i]   = remap[h->indices[i]];
+
+    for( uint32_t f = 0; f < h->face_count; ++f )
+        h->planes[f].d  -= vec3_dot(plane_normal(h->planes[f]), hb->center);
+
+    h->vertex_count = count;
+    return true;
+}
+
+bool
+convex_hull_build(convex_hull_t* h, const vec3_t* points, uint32_t count, uint32_t max_vertices, float tolerance) {
+    memset(h, 0, sizeof(convex_hull_t));
+    if( count < 4 ) return false;
+
+    hull_builder_t  hb;
+    memset(&hb, 0, sizeof(hull_builder_t));
+    hb.input    = points;
+    hb.count    = count;
+    hb.points   = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    hb.next     = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    hb.link     = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    if( !hb.points || !hb.next || !hb.link ) {
+        free(hb.link);
+        free(hb.next);
+        free(hb.points);
+        return false;
+    }
+
+    // work around the center of the bounds: far from the origin, the float
+    // spacing of the coordinates would otherwise dominate the tolerance
+    box3_t  bounds  = box3_empty();
+    for( uint32_t i = 0; i < count; ++i )
+        bounds  = box3_expand(bounds, points[i]);
+    hb.center   = box3_center(bounds);
+
+    vec3_t  range   = vec3(0.0f, 0.0f, 0.0f);
+    for( uint32_t i = 0; i < count; ++i ) {
+        vec3_t  q   = vec3_sub(points[i], hb.center);
+        hb.points[i]    = q;
+        range   = vec3(fmaxf(range.x, fabsf(q.x)), fmaxf(range.y, fabsf(q.y)), fmaxf(range.z, fabsf(q.z)));
+    }
+    // plus the rounding of the shift itself
+    hb.eps  = 3.0f * FLT_EPSILON * (range.x + range.y + range.z) + FLT_EPSILON * (fabsf(hb.center.x) + fabsf(hb.center.y) + fabsf(hb.center.z));
+    hb.eps  = fmaxf(tolerance, hb.eps);
+
+    memset(hb.link, 0xFF, sizeof(uint32_t) * count);
+    bool    ok  = init_simplex(&hb);
+
+    if( ok && max_vertices ) {
+        // greedy: always the point furthest out of the current hull
+        for( uint32_t added = 4; ok && added < max_vertices; ++added ) {
+            uint32_t    best    = HULL_NONE;
+            for( uint32_t f = 0; f < hb.face_count; ++f ) {
+                const hull_face_t*  hf  = &hb.faces[f];
+                if( hf->alive && hf->furthest != HULL_NONE && (best == HULL_NONE || hf->furthest_d > hb.faces[best].furthest_d) ) best = f;
+            }
+            if( best == HULL_NONE ) break;
+            ok  = add_point(&hb, best);
+        }
+    } else if( ok ) {
+        // new faces are appended, a single pass reaches every face that has points above it
+        for( uint32_t f = 0; ok && f < hb.face_count; ++f ) {
+            if( hb.faces[f].alive && hb.faces[f].furthest != HULL_NONE )
+                ok  = add_point(&hb, f);
+        }
+    }
+
+    ok  = ok && extract_faces(&hb, h) && extract_vertices(&hb, h);
+
+    free(hb.horizon.data);
+    free(hb.visible.data);
+    free(hb.stack.data);
+    free(hb.faces);
+    free(hb.link);
+    free(hb.next);
+    free(hb.points);
+
+    if( !ok ) convex_hull_release(h);
+    return ok;
+}
+
+void
+convex_hull_release(convex_hull_t* h) {
+    free(h->vertices);
+    free(h->indices);
+    free(h->face_first);
+    free(h->planes);
+    memset(h, 0, sizeof(convex_hull_t));
+}
+
+/*******************************************************************************
+** containment
+*******************************************************************************/
+bool
+convex_hull_contains(const convex_hull_t* h, vec3_t p, float margin) {
+    for( uint32_t f = 0; f < h->face_count; ++f ) {
+        plane_t pl  = h->planes[f];
+        if( pl.a * p.x + pl.b * p.y + pl.c * p.z + pl.d > margin ) return false;
+    }
+    return h->face_count > 0;
+}
+
+uint32_t
+convex_hull_contains_array(const convex_hull_t* h, const vec3_t* points, uint32_t count, float margin, bool* inside) {
+    int     total   = 0;
+    int     blocks  = (int)((count + HULL_BLOCK - 1) / HULL_BLOCK);
+
+    // planes outside, points inside: the inner loop over a block vectorizes
+#pragma omp parallel for reduction(+:total)
+    for( int b = 0; b < blocks; ++b ) {
+        uint32_t    first   = (uint32_t)b * HULL_BLOCK;
+        uint32_t    n       = count - first < HULL_BLOCK ? count - first : HULL_BLOCK;
+        float       dmax[HULL_BLOCK];
+
+        for( uint32_t i = 0; i < n; ++i )
+            dmax[i] = h->face_count ? -INFINITY : INFINITY;
+
+        for( uint32_t f = 0; f < h->face_count; ++f ) {
+            plane_t pl  = h->planes[f];
+            for( uint32_t i = 0; i < n; ++i ) {
+                vec3_t  p   = points[first + i];
+                float   d   = pl.a * p.x + pl.b * p.y + pl.c * p.z + pl.d;
+                dmax[i] = d > dmax[i] ? d : dmax[i];
+            }
+        }
+
+        for( uint32_t i = 0; i < n; ++i ) {
+            inside[first + i]   = dmax[i] <= margin;
+            total   += inside[first + i] ? 1 : 0;
+        }
+    }
+
+    return (uint32_t)total;
+}
@@ -0,0 +1,298 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS          8
+#define RADIX_SIZE          (1 << RADIX_BITS)
+#define RADIX_CHUNK         16384   /* keys per histogram/scatter chunk */
+#define LBVH_TASK_THRESHOLD 4096
+
+static INLINE
+int
+clz32(uint32_t x) {
+#if defined(__GNUC__)
+    return x ? __builtin_clz(x) : 32;
+#else
+    int     n   = 0;
+    if( x == 0 ) return 32;
+    while( !(x & 0x80000000u) ) {
+        x   <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/* spread the 10 low bits of v so there are 2 zero bits between each */
+static INLINE
+uint32_t
+expand_bits(uint32_t v) {
+    v   = (v * 0x00010001u) & 0xFF0000FFu;
+    v   = (v * 0x00000101u) & 0x0F00F00Fu;
+    v   = (v * 0x00000011u) & 0xC30C30C3u;
+    v   = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+static INLINE
+uint32_t
+quantize(float v, float min, float extent) {
+    float   q   = extent > 0.0f ? (v - min) / extent * 1024.0f : 0.0f;
+    q   = q < 0.0f ? 0.0f : (q > 1023.0f ? 1023.0f : q);
+    return (uint32_t)q;
+}
+
+uint32_t
+morton3(vec3_t p, box3_t scene) {
+    vec3_t      ext = vec3_sub(scene.max, scene.min);
+    uint32_t    x   = quantize(p.x, scene.min.x, ext.x);
+    uint32_t    y   = quantize(p.y, scene.min.y, ext.y);
+    uint32_t    z   = quantize(p.z, scene.min.z, ext.z);
+    return (expand_bits(x) << 2) | (expand_bits(y) << 1) | expand_bits(z);
+}
+
+void
+morton3_array(const vec3_t* points, uint32_t count, box3_t scene, uint32_t* codes) {
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        codes[i]    = morton3(points[i], scene);
+    }
+}
+
+///
+/// LSD radix sort, 8 bits per pass. The keys are split in fixed size chunks that
+/// histogram and scatter in parallel, chunk order within a digit keeps the sort
+/// stable. Passes where every key has the same digit are skipped.
+///
+bool
+radix_sort_u32(uint32_t* keys, uint32_t* values, uint32_t count) {
+    uint32_t    chunks      = (count + RADIX_CHUNK - 1) / RADIX_CHUNK;
+    uint32_t*   tmp_keys    = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    uint32_t*   tmp_values  = values ? (uint32_t*)malloc(sizeof(uint32_t) * count) : NULL;
+    uint32_t*   hist        = (uint32_t*)malloc(sizeof(uint32_t) * RADIX_SIZE * (chunks ? chunks : 1));
+
+    if( !tmp_keys || !hist || (values && !tmp_values) ) {
+        free(tmp_keys);
+        free(tmp_values);
+        free(hist);
+        return false;
+    }
+
+    uint32_t*   src_k   = keys;
+    uint32_t*   src_v   = values;
+    uint32_t*   dst_k   = tmp_keys;
+    uint32_t*   dst_v   = tmp_values;
+
+    for( uint32_t shift = 0; shift < 32; shift += RADIX_BITS ) {
+#pragma omp parallel for
+        for( int c = 0; c < (int)chunks; ++c ) {
+            uint32_t*   h       = &hist[c * RADIX_SIZE];
+            uint32_t    end     = ((uint32_t)c + 1) * RADIX_CHUNK < count ? ((uint32_t)c + 1) * RADIX_CHUNK : count;
+            memset(h, 0, sizeof(uint32_t) * RADIX_SIZE);
+            for( uint32_t i = (uint32_t)c * RADIX_CHUNK; i < end; ++i ) {
+                h[(src_k[i] >> shift) & (RADIX_SIZE - 1)]++;
+            }
+        }
+
+        // exclusive prefix sum, digit major then chunk
+        uint32_t    sum     = 0;
+        bool        skip    = false;
+        for( uint32_t d = 0; d < RADIX_SIZE; ++d ) {
+            uint32_t    start   = sum;
+            for( uint32_t c = 0; c < chunks; ++c ) {
+                uint32_t    n   = hist[c * RADIX_SIZE + d];
+                hist[c * RADIX_SIZE + d]    = sum;
+                sum     += n;
+            }
+            if( sum - start == count ) skip = true;
+        }
+        if( skip ) continue;
+
+#pragma omp parallel for
+        for( int c = 0; c < (int)chunks; ++c ) {
+            uint32_t*   h       = &hist[c * RADIX_SIZE];
+            uint32_t    end     = ((uint32_t)c + 1) * RADIX_CHUNK < count ? ((uint32_t)c + 1) * RADIX_CHUNK : count;
+            for( uint32_t i = (uint32_t)c * RADIX_CHUNK; i < end; ++i ) {
+                uint32_t    dst = h[(src_k[i] >> shift) & (RADIX_SIZE - 1)]++;
+                dst_k[dst]  = src_k[i];
+                if( src_v ) dst_v[dst] = src_v[i];
+            }
+        }
+
+        uint32_t*   t;
+        t = src_k; src_k = dst_k; dst_k = t;
+        t = src_v; src_v = dst_v; dst_v = t;
+    }
+
+    if( src_k != keys ) {
+        memcpy(keys, src_k, sizeof(uint32_t) * count);
+        if( values ) memcpy(values, src_v, sizeof(uint32_t) * count);
+    }
+
+    free(tmp_keys);
+    free(tmp_values);
+    free(hist);
+    return true;
+}
+
+typedef struct {
+    bvh_node_t*     nodes;
+    uint32_t        node_count;
+    const uint32_t* codes;      /* sorted */
+    const uint32_t* indices;    /* primitive of each sorted code */
+    const box3_t*   bounds;
+    uint32_t        max_leaf_size;
+} lbvh_build_t;
+
+///
+/// last index of the left half of the sorted range [first, last]: the highest position
+/// that still shares more leading bits with codes[first] than codes[last] does
+///
+static
+uint32_t
+find_split(const uint32_t* codes, uint32_t first, uint32_t last) {
+    uint32_t    a       = codes[first];
+    uint32_t    b       = codes[last];
+    if( a == b ) return (first + last) >> 1;
+
+    int         prefix  = clz32(a ^ b);
+    uint32_t    split   = first;
+    uint32_t    step    = last - first;
+    do {
+        step    = (step + 1) >> 1;
+        uint32_t    ns  = split + step;
+        if( ns < last && clz32(a ^ codes[ns]) > prefix ) split = ns;
+    } while( step > 1 );
+    return split;
+}
+
+static
+uint32_t
+alloc_node_pair(lbvh_build_t* b) {
+    uint32_t    first;
+#pragma omp atomic capture
+    { first = b->node_count; b->node_count += 2; }
+    return first;
+}
+
+static
+void
+build_node(lbvh_build_t* b, uint32_t node, uint32_t begin, uint32_t end) {
+    uint32_t    count   = end - begin;
+
+    if( count <= b->max_leaf_size ) {
+        box3_t  nb  = box3_empty();
+        for( uint32_t i = begin; i < end; ++i ) {
+            nb  = box3_union(nb, b->bounds[b->indices[i]]);
+        }
+        b->nodes[node].bounds   = nb;
+        b->nodes[node].first    = begin;
+        b->nodes[node].count    = count;
+        return;
+    }
+
+    uint32_t    mid     = find_split(b->codes, begin, end - 1) + 1;
+    uint32_t    child   = alloc_node_pair(b);
+
+    if( count > LBVH_TASK_THRESHOLD ) {
+#pragma omp task firstprivate(b, child, begin, mid)
+        build_node(b, child, begin, mid);
+        build_node(b, child + 1, mid, end);
+#pragma omp taskwait
+    } else {
+        build_node(b, child, begin, mid);
+        build_node(b, child + 1, mid, end);
+    }
+
+    b->nodes[node].bounds   = box3_union(b->nodes[child].bounds, b->nodes[child + 1].bounds);
+    b->nodes[node].first    = child;
+    b->nodes[node].count    = 0;
+}
+
+bool
+bvh_build_lbvh(bvh_t* bvh, const box3_t* prim_bounds, uint32_t count, uint32_t max_leaf_size) {
+    memset(bvh, 0, sizeof(bvh_t));
+    if( count == 0 ) return false;
+
+    vec3_t*     centroids   = (vec3_t*)malloc(sizeof(vec3_t) * count);
+    uint32_t*   codes       = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    bvh->nodes              = (bvh_node_t*)malloc(sizeof(bvh_node_t) * (2 * (size_t)count - 1));
+    bvh->prim_indices       = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    if( !centroids || !codes || !bvh->nodes || !bvh->prim_indices ) {
+        free(centroids);
+        free(codes);
+        bvh_release(bvh);
+        return false;
+    }
+
+    float   min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
+    float   max_x = -FLT_MAX, max_y = -FLT_MAX, max_z = -FLT_MAX;
+
+#pragma omp parallel for reduction(min: min_x, min_y, min_z) reduction(max: max_x, max_y, max_z)
+    for( int i = 0; i < (int)count; ++i ) {
+        vec3_t  c   = box3_center(prim_bounds[i]);
+        centroids[i]            = c;
+        bvh->prim_indices[i]    = (uint32_t)i;
+        min_x   = c.x < min_x ? c.x : min_x;
+        min_y   = c.y < min_y ? c.y : min_y;
+        min_z   = c.z < min_z ? c.z : min_z;
+        max_x   = c.x > max_x ? c.x : max_x;
+        max_y   = c.y > max_y ? c.y : max_y;
+        max_z   = c.z > max_z ? c.z : max_z;
+    }
+
+    box3_t  scene;
+    scene.min   = vec3(min_x, min_y, min_z);
+    scene.max   = vec3(max_x, max_y, max_z);
+    morton3_array(centroids, count, scene, codes);
+    free(centroids);
+
+    if( !radix_sort_u32(codes, bvh->prim_indices, count) ) {
+        free(codes);
+        bvh_release(bvh);
+        return false;
+    }
+
+    lbvh_build_t    b;
+    b.nodes         = bvh->nodes;
+    b.node_count    = 1;
+    b.codes         = codes;
+    b.indices       = bvh->prim_indices;
+    b.bounds        = prim_bounds;
+    b.max_leaf_size = max_leaf_size ? max_leaf_size : 1;
+
+#pragma omp parallel
+#pragma omp single nowait
+    build_node(&b, 0, 0, count);
+
+    free(codes);
+
+    bvh->node_count     = b.node_count;
+    bvh->prim_count     = count;
+    bvh->max_leaf_size  = b.max_leaf_size;
+
+    bvh_node_t* nodes   = (bvh_node_t*)realloc(bvh->nodes, sizeof(bvh_node_t) * bvh->node_count);
+    if( nodes ) bvh->nodes = nodes;
+    return true;
+}
@@ -0,0 +1,226 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* zero for a zero vector instead of NaN */
+static INLINE
+vec3_t
+normalize_or_zero(vec3_t v) {
+    float   len = vec3_length(v);
+    return len > 0.0f ? vec3_mulf(v, 1.0f / len) : vec3(0.0f, 0.0f, 0.0f);
+}
+
+static INLINE
+uint32_t
+corner_vertex(tri3_mesh_t mesh, uint32_t corner) {
+    return mesh.indices ? mesh.indices[corner] : corner;
+}
+
+/* angle between two edges, 0 when one is degenerate */
+static INLINE
+float
+corner_angle(vec3_t e1, vec3_t e2) {
+    vec3_t  a   = normalize_or_zero(e1);
+    vec3_t  b   = normalize_or_zero(e2);
+    float   d   = vec3_dot(a, b);
+    if( vec3_dot(a, a) == 0.0f || vec3_dot(b, b) == 0.0f ) return 0.0f;
+    return acosf(d < -1.0f ? -1.0f : (d > 1.0f ? 1.0f : d));
+}
+
+/*
+ * the corners of each vertex in corner order, a counting sort: the per
+ * vertex sums then gather without atomics and independently of the threads
+ */
+static
+bool
+vertex_corners(tri3_mesh_t mesh, uint32_t vertex_count, uint32_t** first, uint32_t** corners) {
+    uint32_t    corner_count    = mesh.tri_count * 3;
+
+    *first      = (uint32_t*)calloc((size_t)vertex_count + 1, sizeof(uint32_t));
+    *corners    = (uint32_t*)malloc(sizeof(uint32_t) * (corner_count ? corner_count : 1));
+    if( !*first || !*corners ) {
+        free(*first);
+        free(*corners);
+        return false;
+    }
+
+    for( uint32_t c = 0; c < corner_count; ++c )
+        ++(*first)[corner_vertex(mesh, c) + 1];
+    for( uint32_t v = 0; v < vertex_count; ++v )
+        (*first)[v + 1] += (*first)[v];
+    for( uint32_t c = 0; c < corner_count; ++c )
+        (*corners)[(*first)[corner_vertex(mesh, c)]++] = c;
+
+    // the fill moved each start to the next one
+    for( uint32_t v = vertex_count; v > 0; --v )
+        (*first)[v] = (*first)[v - 1];
+    (*first)[0] = 0;
+    return true;
+}
+
+void
+tri3_mesh_face_normals(tri3_mesh_t mesh, vec3_t* normals, float* areas) {
+#pragma omp parallel for
+    for( int t = 0; t < (int)mesh.tri_count; ++t ) {
+        vec3_t  v0, v1, v2;
+        tri3_mesh_triangle(mesh, (uint32_t)t, &v0, &v1, &v2);
+
+        vec3_t  n   = vec3_cross(vec3_sub(v1, v0), vec3_sub(v2, v0));
+        float   len = vec3_length(n);
+        if( normals ) normals[t] = len > 0.0f ? vec3_mulf(n, 1.0f / len) : vec3(0.0f, 0.0f, 0.0f);
+        if( areas ) areas[t] = 0.5f * len;
+    }
+}
+
+bool
+tri3_mesh_vertex_normals(tri3_mesh_t mesh, uint32_t vertex_count, normal_weight_t weight, vec3_t* normals) {
+    uint32_t    corner_count    = mesh.tri_count * 3;
+    vec3_t*     contrib;
+    uint32_t*   first;
+    uint32_t*   corners;
+
+    contrib = (vec3_t*)malloc(sizeof(vec3_t) * (corner_count ? corner_count : 1));
+    if( !contrib ) return false;
+    if( !vertex_corners(mesh, vertex_count, &first, &corners) ) {
+        free(contrib);
+        return false;
+    }
+
+#pragma omp parallel for
+    for( int t = 0; t < (int)mesh.tri_count; ++t ) {
+        vec3_t  v[3];
+        tri3_mesh_triangle(mesh, (uint32_t)t, &v[0], &v[1], &v[2]);
+
+        // the cross product is twice the area along the normal
+        vec3_t  n   = vec3_cross(vec3_sub(v[1], v[0]), vec3_sub(v[2], v[0]));
+        if( weight == NORMAL_WEIGHT_AREA ) {
+            contrib[t * 3] = contrib[t * 3 + 1] = contrib[t * 3 + 2] = n;
+            continue;
+        }
+
+        n   = normalize_or_zero(n);
+        for( int k = 0; k < 3; ++k )
+            contrib[t * 3 + k]  = vec3_mulf(n, corner_angle(vec3_sub(v[(k + 1) % 3], v[k]), vec3_sub(v[(k + 2) % 3], v[k])));
+    }
+
+#pragma omp parallel for
+    for( int v = 0; v < (int)vertex_count; ++v ) {
+        vec3_t  n   = vec3(0.0f, 0.0f, 0.0f);
+        for( uint32_t k = first[v]; k < first[v + 1]; ++k )
+            n   = vec3_add(n, contrib[corners[k]]);
+        normals[v]  = normalize_or_zero(n);
+    }
+
+    free(contrib);
+    free(first);
+    free(corners);
+    return true;
+}
+
+/* unit vector orthogonal to a unit n */
+static INLINE
+vec3_t
+any_orthogonal(vec3_t n) {
+    vec3_t  t   = fabsf(n.x) > fabsf(n.z) ? vec3(-n.y, n.x, 0.0f) : vec3(0.0f, -n.z, n.y);
+    t   = normalize_or_zero(t);
+    return vec3_dot(t, t) > 0.0f ? t : vec3(1.0f, 0.0f, 0.0f);
+}
+
+bool
+tri3_mesh_tangents(tri3_mesh_t mesh, uint32_t vertex_count, const vec3_t* normals, const vec2_t* uvs, vec4_t* tangents) {
+    uint32_t    corner_count    = mesh.tri_count * 3;
+    vec3_t*     ts;
+    vec3_t*     bs;
+    uint32_t*   first;
+    uint32_t*   corners;
+
+    ts  = (vec3_t*)malloc(sizeof(vec3_t) * (corner_count ? corner_count : 1));
+    bs  = (vec3_t*)malloc(sizeof(vec3_t) * (corner_count ? corner_count : 1));
+    if( !ts || !bs || !vertex_corners(mesh, vertex_count, &first, &corners) ) {
+        free(ts);
+        free(bs);
+        return false;
+    }
+
+    // MikkTSpace face derivatives, projected on the tangent plane of each
+    // corner's vertex normal, normalized and weighted by the projected angle
+#pragma omp parallel for
+    for( int t = 0; t < (int)mesh.tri_count; ++t ) {
+        uint32_t    idx[3];
+        vec3_t      p[3];
+        vec2_t      uv[3];
+
+        for( int k = 0; k < 3; ++k ) {
+            idx[k]  = corner_vertex(mesh, (uint32_t)t * 3 + k);
+            p[k]    = mesh.vertices[idx[k]];
+            uv[k]   = uvs[idx[k]];
+        }
+
+        vec3_t  d1      = vec3_sub(p[1], p[0]);
+        vec3_t  d2      = vec3_sub(p[2], p[0]);
+        vec2_t  t1      = vec2_sub(uv[1], uv[0]);
+        vec2_t  t2      = vec2_sub(uv[2], uv[0]);
+        float   st_area = t1.x * t2.y - t1.y * t2.x;
+        vec3_t  os      = vec3_sub(vec3_mulf(d1, t2.y), vec3_mulf(d2, t1.y));
+        vec3_t  ot      = vec3_sub(vec3_mulf(d2, t1.x), vec3_mulf(d1, t2.x));
+
+        // the sign of the texture area orients the frame, a mirrored face flips it
+        if( st_area < 0.0f ) {
+            os  = vec3_neg(os);
+            ot  = vec3_neg(ot);
+        }
+
+        for( int k = 0; k < 3; ++k ) {
+            vec3_t  n   = normals[idx[k]];
+            vec3_t  e1  = vec3_sub(p[(k + 1) % 3], p[k]);
+            vec3_t  e2  = vec3_sub(p[(k + 2) % 3], p[k]);
+            float   a   = st_area != 0.0f ? corner_angle(vec3_sub(e1, vec3_mulf(n, vec3_dot(n, e1))), vec3_sub(e2, vec3_mulf(n, vec3_dot(n, e2)))) : 0.0f;
+
+            ts[t * 3 + k]   = vec3_mulf(normalize_or_zero(vec3_sub(os, vec3_mulf(n, vec3_dot(n, os)))), a);
+            bs[t * 3 + k]   = vec3_mulf(normalize_or_zero(vec3_sub(ot, vec3_mulf(n, vec3_dot(n, ot)))), a);
+        }
+    }
+
+#pragma omp parallel for
+    for( int v = 0; v < (int)vertex_count; ++v ) {
+        vec3_t  n   = normals[v];
+        vec3_t  t   = vec3(0.0f, 0.0f, 0.0f);
+        vec3_t  b   = vec3(0.0f, 0.0f, 0.0f);
+        for( uint32_t k = first[v]; k < first[v + 1]; ++k ) {
+            t   = vec3_add(t, ts[corners[k]]);
+            b   = vec3_add(b, bs[corners[k]]);
+        }
+
+        t   = normalize_or_zero(vec3_sub(t, vec3_mulf(n, vec3_dot(n, t))));
+        if( vec3_dot(t, t) == 0.0f ) t = any_orthogonal(n);
+
+        // bitangent = w * cross(n, t) as in MikkTSpace
+        tangents[v] = vec4(t.x, t.y, t.z, vec3_dot(vec3_cross(n, t), b) < 0.0f ? -1.0f : 1.0f);
+    }
+
+    free(ts);
+    free(bs);
+    free(first);
+    free(corners);
+    return true;
+}
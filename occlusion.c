@@ -0,0 +1,229 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OCCLUSION_TEST_TEXELS   4       /* a box tests at most this many texels per axis */
+
+static
+bool
+reserve_vertices(occlusion_buffer_t* b, uint32_t capacity) {
+    if( capacity <= b->vertex_capacity ) return true;
+
+    vec4_t*     clip    = (vec4_t*)realloc(b->clip, sizeof(vec4_t) * capacity);
+    if( clip ) b->clip = clip;
+    uint8_t*    codes   = (uint8_t*)realloc(b->codes, sizeof(uint8_t) * capacity);
+    if( codes ) b->codes = codes;
+
+    if( !clip || !codes ) return false;
+    b->vertex_capacity  = capacity;
+    return true;
+}
+
+static
+bool
+reserve_triangles(occlusion_buffer_t* b, uint32_t capacity) {
+    if( capacity <= b->tri_capacity ) return true;
+
+    screen_tri_t*   tris    = (screen_tri_t*)realloc(b->tris, sizeof(screen_tri_t) * capacity);
+    if( tris ) b->tris = tris;
+    vec2_t*         points  = (vec2_t*)realloc(b->points, sizeof(vec2_t) * 3 * capacity);
+    if( points ) b->points = points;
+    float*          depths  = (float*)realloc(b->depths, sizeof(float) * 3 * capacity);
+    if( depths ) b->depths = depths;
+
+    if( !tris || !points || !depths ) return false;
+    b->tri_capacity = capacity;
+    return true;
+}
+
+bool
+occlusion_buffer_init(occlusion_buffer_t* b, int width, int height) {
+    size_t  total   = 0;
+
+    memset(b, 0, sizeof(occlusion_buffer_t));
+    if( width < 1 || height < 1 ) return false;
+
+    b->width        = width;
+    b->height       = height;
+    b->view_proj    = mat4_identity();
+
+    // 2x2 max reductions down to a single texel
+    for( int w = width, h = height; b->level_count < OCCLUSION_MAX_LEVELS; w = (w + 1) / 2, h = (h + 1) / 2 ) {
+        b->level_size[b->level_count++] = ivec2(w, h);
+        total   += (size_t)w * (size_t)h;
+        if( w == 1 && h == 1 ) break;
+    }
+
+    b->level[0] = (float*)malloc(sizeof(float) * total);
+    if( !b->level[0] ) return false;
+    for( int l = 1; l < b->level_count; ++l )
+        b->level[l] = b->level[l - 1] + b->level_size[l - 1].x * b->level_size[l - 1].y;
+    return true;
+}
+
+void
+occlusion_buffer_release(occlusion_buffer_t* b) {
+    free(b->level[0]);
+    free(b->clip);
+    free(b->codes);
+    free(b->tris);
+    free(b->points);
+    free(b->depths);
+    memset(b, 0, sizeof(occlusion_buffer_t));
+}
+
+void
+occlusion_buffer_begin(occlusion_buffer_t* b, mat4_t view_proj) {
+    raster_target_t t   = raster_target(b->width, b->height, b->level[0], NULL);
+
+    b->view_proj    = view_proj;
+    raster_clear(&t, 1.0f, 0);
+}
+
+bool
+occlusion_buffer_add_occluder(occlusion_buffer_t* b, mat4_t world, const vec3_t* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t tri_count) {
+    raster_target_t t   = raster_target(b->width, b->height, b->level[0], NULL);
+    vec2_t          lb  = vec2(0.0f, (float)b->height);
+    vec2_t          rt  = vec2((float)b->width, 0.0f);
+
+    if( !reserve_vertices(b, vertex_count) ) return false;
+
+    transform_vec3_array(mat4_mulm(b->view_proj, world), vertices, vertex_count, b->clip);
+    if( clip_outcode_array(b->clip, vertex_count, b->codes) ) return true;
+
+    // y flipped viewport: rows go down like the rasterizer's
+    uint32_t        count   = clip_tri4_to_screen(b->clip, b->codes, indices, tri_count, lb, rt, CULL_BACK, b->tris, b->tri_capacity);
+    if( count > b->tri_capacity ) {
+        if( !reserve_triangles(b, count) ) return false;
+        clip_tri4_to_screen(b->clip, b->codes, indices, tri_count, lb, rt, CULL_BACK, b->tris, b->tri_capacity);
+    }
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        for( int k = 0; k < 3; ++k ) {
+            b->points[i * 3 + k]    = vec2(b->tris[i].v[k].x, b->tris[i].v[k].y);
+            b->depths[i * 3 + k]    = b->tris[i].v[k].z;
+        }
+    }
+
+    return raster_tri2_array(&t, b->points, b->depths, NULL, count);
+}
+
+void
+occlusion_buffer_build(occlusion_buffer_t* b) {
+    for( int l = 1; l < b->level_count; ++l ) {
+        ivec2_t         src     = b->level_size[l - 1];
+        ivec2_t         dst     = b->level_size[l];
+        const float*    in      = b->level[l - 1];
+        float*          out     = b->level[l];
+
+#pragma omp parallel for if(dst.x * dst.y >= 4096)
+        for( int y = 0; y < dst.y; ++y ) {
+            const float*    r0  = &in[(2 * y) * src.x];
+            const float*    r1  = &in[MIN(2 * y + 1, src.y - 1) * src.x];
+            for( int x = 0; x < dst.x; ++x ) {
+                int     x0  = 2 * x;
+                int     x1  = MIN(2 * x + 1, src.x - 1);
+                out[y * dst.x + x]  = MAX(MAX(r0[x0], r0[x1]), MAX(r1[x0], r1[x1]));
+            }
+        }
+    }
+}
+
+bool
+occlusion_buffer_test_box(const occlusion_buffer_t* b, box3_t box) {
+    const mat4_t*   m   = &b->view_proj;
+    float           x[8], y[8], z[8], w[8];
+    uint32_t        all = 0x3F;
+    uint32_t        any = 0;
+
+    // the corners as 8 lanes
+    for( int k = 0; k < 8; ++k ) {
+        float   px  = k & 1 ? box.max.x : box.min.x;
+        float   py  = k & 2 ? box.max.y : box.min.y;
+        float   pz  = k & 4 ? box.max.z : box.min.z;
+        x[k]    = m->col[0].x * px + m->col[1].x * py + m->col[2].x * pz + m->col[3].x;
+        y[k]    = m->col[0].y * px + m->col[1].y * py + m->col[2].y * pz + m->col[3].y;
+        z[k]    = m->col[0].z * px + m->col[1].z * py + m->col[2].z * pz + m->col[3].z;
+        w[k]    = m->col[0].w * px + m->col[1].w * py + m->col[2].w * pz + m->col[3].w;
+    }
+
+    for( int k = 0; k < 8; ++k ) {
+        uint32_t    code    = (x[k] < -w[k] ? OUTCODE_LEFT : 0)   | (x[k] > w[k] ? OUTCODE_RIGHT : 0) |
+                              (y[k] < -w[k] ? OUTCODE_BOTTOM : 0) | (y[k] > w[k] ? OUTCODE_TOP : 0)   |
+                              (z[k] < -w[k] ? OUTCODE_NEAR : 0)   | (z[k] > w[k] ? OUTCODE_FAR : 0);
+        all &= code;
+        any |= code;
+    }
+    if( all ) return false;
+    // crossing the near plane, the projection is unbounded
+    if( any & OUTCODE_NEAR ) return true;
+
+    float   min_x   = FLT_MAX,  min_y   = FLT_MAX,  min_z   = FLT_MAX;
+    float   max_x   = -FLT_MAX, max_y   = -FLT_MAX;
+    for( int k = 0; k < 8; ++k ) {
+        float   iw  = 1.0f / w[k];
+        min_x   = MIN(min_x, x[k] * iw);
+        max_x   = MAX(max_x, x[k] * iw);
+        min_y   = MIN(min_y, y[k] * iw);
+        max_y   = MAX(max_y, y[k] * iw);
+        min_z   = MIN(min_z, z[k] * iw);
+    }
+
+    // every pixel the rectangle touches, rows down as in occlusion_buffer_add_occluder
+    float   fw  = (float)b->width;
+    float   fh  = (float)b->height;
+    int     x0  = (int)floorf(MAX((min_x + 1.0f) * 0.5f * fw, 0.0f));
+    int     x1  = (int)ceilf(MIN((max_x + 1.0f) * 0.5f * fw, fw)) - 1;
+    int     y0  = (int)floorf(MAX((1.0f - max_y) * 0.5f * fh, 0.0f));
+    int     y1  = (int)ceilf(MIN((1.0f - min_y) * 0.5f * fh, fh)) - 1;
+    float   near = (min_z + 1.0f) * 0.5f;
+
+    x0  = MIN(x0, b->width - 1);
+    y0  = MIN(y0, b->height - 1);
+    x1  = MAX(x1, x0);
+    y1  = MAX(y1, y0);
+
+    int     l   = 0;
+    while( l + 1 < b->level_count && ((x1 >> l) - (x0 >> l) >= OCCLUSION_TEST_TEXELS || (y1 >> l) - (y0 >> l) >= OCCLUSION_TEST_TEXELS) ) ++l;
+
+    const float*    level   = b->level[l];
+    int             stride  = b->level_size[l].x;
+    for( int ty = y0 >> l; ty <= y1 >> l; ++ty )
+        for( int tx = x0 >> l; tx <= x1 >> l; ++tx )
+            if( near <= level[ty * stride + tx] ) return true;
+    return false;
+}
+
+uint32_t
+occlusion_buffer_test_box_array(const occlusion_buffer_t* b, const box3_t* boxes, uint32_t count, bool* visible) {
+    uint32_t    total   = 0;
+
+#pragma omp parallel for reduction(+:total)
+    for( int i = 0; i < (int)count; ++i ) {
+        visible[i]  = occlusion_buffer_test_box(b, boxes[i]);
+        total       += visible[i] ? 1 : 0;
+    }
+    return total;
+}
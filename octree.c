@@ -0,0 +1,381 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERY_STACK_SIZE    (7 * OCTREE_MAX_DEPTH + 8)
+
+static INLINE
+box3_t
+loose_bounds(box3_t b, float looseness) {
+    vec3_t  c   = box3_center(b);
+    vec3_t  e   = vec3_mulf(box3_extent(b), looseness);
+    return box3(vec3_sub(c, e), vec3_add(c, e));
+}
+
+static INLINE
+bool
+contains(box3_t outer, box3_t inner) {
+    return inner.min.x >= outer.min.x && inner.min.y >= outer.min.y && inner.min.z >= outer.min.z &&
+           inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+/*******************************************************************************
+** pools
+*******************************************************************************/
+static
+uint32_t
+alloc_block(octree_t* o) {
+    if( o->free_blocks != OCTREE_NONE ) {
+        uint32_t    first   = o->free_blocks;
+        o->free_blocks      = o->nodes[first].items;
+        return first;
+    }
+
+    if( o->node_count + 8 > o->node_capacity ) {
+        uint32_t        capacity    = o->node_capacity * 2;
+        octree_node_t*  nodes       = (octree_node_t*)realloc(o->nodes, sizeof(octree_node_t) * capacity);
+        if( !nodes ) return OCTREE_NONE;
+        o->nodes            = nodes;
+        o->node_capacity    = capacity;
+    }
+
+    uint32_t    first   = o->node_count;
+    o->node_count       += 8;
+    return first;
+}
+
+static
+void
+free_subtree(octree_t* o, uint32_t first) {
+    for( uint32_t i = first; i < first + 8; ++i ) {
+        if( o->nodes[i].children != OCTREE_NONE ) {
+            free_subtree(o, o->nodes[i].children);
+        }
+    }
+    o->nodes[first].items   = o->free_blocks;
+    o->free_blocks          = first;
+}
+
+static
+uint32_t
+alloc_item(octree_t* o) {
+    if( o->free_items != OCTREE_NONE ) {
+        uint32_t    item    = o->free_items;
+        o->free_items       = o->items[item].next;
+        return item;
+    }
+
+    if( o->item_count + 1 > o->item_capacity ) {
+        uint32_t        capacity    = o->item_capacity * 2;
+        octree_item_t*  items       = (octree_item_t*)realloc(o->items, sizeof(octree_item_t) * capacity);
+        if( !items ) return OCTREE_NONE;
+        o->items            = items;
+        o->item_capacity    = capacity;
+    }
+
+    return o->item_count++;
+}
+
+/*******************************************************************************
+** tree maintenance
+*******************************************************************************/
+static
+void
+link_item(octree_t* o, uint32_t node, uint32_t item) {
+    octree_item_t*  it  = &o->items[item];
+    it->node    = node;
+    it->prev    = OCTREE_NONE;
+    it->next    = o->nodes[node].items;
+    if( it->next != OCTREE_NONE ) o->items[it->next].prev = item;
+    o->nodes[node].items    = item;
+    o->nodes[node].item_count++;
+
+    for( uint32_t n = node; n != OCTREE_NONE; n = o->nodes[n].parent ) {
+        o->nodes[n].total_count++;
+    }
+}
+
+static
+void
+unlink_item(octree_t* o, uint32_t item) {
+    octree_item_t*  it      = &o->items[item];
+    uint32_t        node    = it->node;
+
+    if( it->prev != OCTREE_NONE ) o->items[it->prev].next = it->next;
+    else o->nodes[node].items = it->next;
+    if( it->next != OCTREE_NONE ) o->items[it->next].prev = it->prev;
+    o->nodes[node].item_count--;
+
+    for( uint32_t n = node; n != OCTREE_NONE; n = o->nodes[n].parent ) {
+        o->nodes[n].total_count--;
+    }
+    it->node    = OCTREE_NONE;
+}
+
+/* the child of node whose loose bounds contain b, OCTREE_NONE if none does */
+static INLINE
+uint32_t
+child_for(const octree_t* o, uint32_t node, box3_t b) {
+    const octree_node_t*    n   = &o->nodes[node];
+    if( n->children == OCTREE_NONE ) return OCTREE_NONE;
+    uint32_t    c   = n->children + box3_octant(n->bounds, box3_center(b));
+    return contains(o->nodes[c].loose, b) ? c : OCTREE_NONE;
+}
+
+static
+uint32_t
+find_node(const octree_t* o, box3_t b) {
+    uint32_t    node    = 0;
+    for( uint32_t c = child_for(o, node, b); c != OCTREE_NONE; c = child_for(o, node, b) ) {
+        node    = c;
+    }
+    return node;
+}
+
+/* split an over full leaf and push down the items that fit in a child */
+static
+void
+split(octree_t* o, uint32_t node) {
+    if( o->nodes[node].children != OCTREE_NONE ||
+        o->nodes[node].item_count <= o->split_threshold ||
+        o->nodes[node].depth >= o->max_depth ) {
+        return;
+    }
+
+    uint32_t    first   = alloc_block(o);
+    if( first == OCTREE_NONE ) return;
+
+    box3_t      octants[8];
+    box3_subdivide(o->nodes[node].bounds, octants);
+    for( uint32_t i = 0; i < 8; ++i ) {
+        octree_node_t*  c   = &o->nodes[first + i];
+        c->bounds       = octants[i];
+        c->loose        = loose_bounds(octants[i], o->looseness);
+        c->parent       = node;
+        c->children     = OCTREE_NONE;
+        c->items        = OCTREE_NONE;
+        c->item_count   = 0;
+        c->total_count  = 0;
+        c->depth        = o->nodes[node].depth + 1;
+    }
+    o->nodes[node].children = first;
+
+    uint32_t    item    = o->nodes[node].items;
+    while( item != OCTREE_NONE ) {
+        uint32_t    next    = o->items[item].next;
+        uint32_t    c       = child_for(o, node, o->items[item].bounds);
+        if( c != OCTREE_NONE ) {
+            unlink_item(o, item);
+            link_item(o, c, item);
+        }
+        item    = next;
+    }
+
+    for( uint32_t i = first; i < first + 8; ++i ) {
+        split(o, i);
+    }
+}
+
+/* release the children of the nodes on the path to the root whose subtree below them is empty */
+static
+void
+collapse(octree_t* o, uint32_t node) {
+    for( uint32_t n = node; n != OCTREE_NONE; n = o->nodes[n].parent ) {
+        octree_node_t*  nd  = &o->nodes[n];
+        if( nd->children != OCTREE_NONE && nd->total_count == nd->item_count ) {
+            free_subtree(o, nd->children);
+            nd->children    = OCTREE_NONE;
+        }
+    }
+}
+
+/*******************************************************************************
+** public interface
+*******************************************************************************/
+bool
+octree_init(octree_t* o, box3_t world, float looseness, uint32_t max_depth, uint32_t split_threshold, uint32_t capacity) {
+    memset(o, 0, sizeof(octree_t));
+    capacity            = capacity ? capacity : 64;
+    o->node_capacity    = 1 + 8 * (capacity / 4 + 1);
+    o->item_capacity    = capacity;
+    o->nodes            = (octree_node_t*)malloc(sizeof(octree_node_t) * o->node_capacity);
+    o->items            = (octree_item_t*)malloc(sizeof(octree_item_t) * o->item_capacity);
+    if( !o->nodes || !o->items ) {
+        octree_release(o);
+        return false;
+    }
+
+    o->looseness        = looseness > 1.0f ? looseness : 1.0f;
+    o->max_depth        = max_depth < OCTREE_MAX_DEPTH ? max_depth : OCTREE_MAX_DEPTH;
+    o->split_threshold  = split_threshold;
+    o->free_blocks      = OCTREE_NONE;
+    o->free_items       = OCTREE_NONE;
+    o->node_count       = 1;
+
+    octree_node_t*  root    = &o->nodes[0];
+    root->bounds        = world;
+    root->loose         = loose_bounds(world, o->looseness);
+    root->parent        = OCTREE_NONE;
+    root->children      = OCTREE_NONE;
+    root->items         = OCTREE_NONE;
+    root->item_count    = 0;
+    root->total_count   = 0;
+    root->depth         = 0;
+    return true;
+}
+
+void
+octree_release(octree_t* o) {
+    free(o->nodes);
+    free(o->items);
+    memset(o, 0, sizeof(octree_t));
+}
+
+uint32_t
+octree_insert(octree_t* o, box3_t bounds, uint32_t user) {
+    uint32_t    item    = alloc_item(o);
+    if( item == OCTREE_NONE ) return OCTREE_NONE;
+
+    o->items[item].bounds   = bounds;
+    o->items[item].user     = user;
+
+    uint32_t    node    = find_node(o, bounds);
+    link_item(o, node, item);
+    split(o, node);
+    return item;
+}
+
+void
+octree_remove(octree_t* o, uint32_t item) {
+    uint32_t    node    = o->items[item].node;
+    if( node == OCTREE_NONE ) return;
+
+    unlink_item(o, item);
+    o->items[item].next = o->free_items;
+    o->free_items       = item;
+    collapse(o, node);
+}
+
+void
+octree_move(octree_t* o, uint32_t item, box3_t bounds) {
+    uint32_t    node    = o->items[item].node;
+    if( node == OCTREE_NONE ) return;
+
+    o->items[item].bounds   = bounds;
+
+    // still the deepest node that contains it: nothing to relink
+    if( (node == 0 || contains(o->nodes[node].loose, bounds)) && child_for(o, node, bounds) == OCTREE_NONE ) {
+        return;
+    }
+
+    unlink_item(o, item);
+    uint32_t    dest    = find_node(o, bounds);
+    link_item(o, dest, item);
+    split(o, dest);
+    collapse(o, node);
+}
+
+typedef enum {
+    QUERY_BOX3,
+    QUERY_SPHERE,
+    QUERY_RAY3
+} query_kind_t;
+
+typedef struct {
+    query_kind_t    kind;
+    box3_t          box;
+    vec3_t          center;
+    float           radius;
+    ray3_inv_t      ray;
+    float           tmax;
+} query_t;
+
+static INLINE
+bool
+query_overlaps(const query_t* q, box3_t b) {
+    switch( q->kind ) {
+    case QUERY_BOX3:    return box3_overlap(b, q->box);
+    case QUERY_SPHERE:  return intersect_box3_sphere(b, q->center, q->radius);
+    case QUERY_RAY3:    return intersect_box3_ray3_inv(b, q->ray, 0.0f, q->tmax, NULL, NULL);
+    }
+    return false;
+}
+
+///
+/// depth first traversal, the node loose bounds prune the subtrees and the item
+/// bounds select the items. The root is never pruned: it also holds the items
+/// outside the world box.
+///
+static
+uint32_t
+query(const octree_t* o, const query_t* q, uint32_t* out, uint32_t max_out) {
+    uint32_t    stack[QUERY_STACK_SIZE];
+    uint32_t    sp      = 0;
+    uint32_t    found   = 0;
+
+    stack[sp++] = 0;
+    while( sp ) {
+        uint32_t                ni  = stack[--sp];
+        const octree_node_t*    n   = &o->nodes[ni];
+        if( n->total_count == 0 || (ni != 0 && !query_overlaps(q, n->loose)) ) continue;
+
+        for( uint32_t it = n->items; it != OCTREE_NONE; it = o->items[it].next ) {
+            if( query_overlaps(q, o->items[it].bounds) ) {
+                if( found < max_out ) out[found] = o->items[it].user;
+                ++found;
+            }
+        }
+
+        if( n->children != OCTREE_NONE ) {
+            for( uint32_t c = 0; c < 8; ++c ) stack[sp++] = n->children + c;
+        }
+    }
+    return found;
+}
+
+uint32_t
+octree_query_box3(const octree_t* o, box3_t b, uint32_t* out, uint32_t max_out) {
+    query_t     q;
+    q.kind      = QUERY_BOX3;
+    q.box       = b;
+    return query(o, &q, out, max_out);
+}
+
+uint32_t
+octree_query_sphere(const octree_t* o, vec3_t center, float radius, uint32_t* out, uint32_t max_out) {
+    query_t     q;
+    q.kind      = QUERY_SPHERE;
+    q.center    = center;
+    q.radius    = radius;
+    return query(o, &q, out, max_out);
+}
+
+uint32_t
+octree_query_ray3(const octree_t* o, ray3_t r, float tmax, uint32_t* out, uint32_t max_out) {
+    query_t     q;
+    q.kind      = QUERY_RAY3;
+    q.ray       = ray3_inv(r);
+    q.tmax      = tmax;
+    return query(o, &q, out, max_out);
+}
@@ -0,0 +1,229 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#define EPSILON (1.0f / (1024.0f * 1024.f))
+
+uint32_t
+ray3_packet(ray3_packet_t* p, const ray3_t* rays, uint32_t count, float tmax) {
+    uint32_t    mask    = 0;
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        // inactive lanes get a degenerate ray that never hits anything
+        ray3_t  r   = i < count ? rays[i] : ray3_from(vec3(0.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f));
+        p->ox[i]    = r.start.x;
+        p->oy[i]    = r.start.y;
+        p->oz[i]    = r.start.z;
+        p->dx[i]    = r.direction.x;
+        p->dy[i]    = r.direction.y;
+        p->dz[i]    = r.direction.z;
+        p->ix[i]    = 1.0f / r.direction.x;
+        p->iy[i]    = 1.0f / r.direction.y;
+        p->iz[i]    = 1.0f / r.direction.z;
+        p->tmax[i]  = i < count ? tmax : -1.0f;
+        mask        |= (i < count ? 1u : 0u) << i;
+    }
+    return mask;
+}
+
+///
+/// slab test on all the lanes, the per lane direction signs differ so each lane
+/// picks its near/far planes from the sign of its inverse direction like slab_test.
+/// NaN slab distances (ray on a slab plane) fail the comparisons and are dropped
+/// the same way as intersect_box3_ray3_inv.
+///
+uint32_t
+intersect_box3_ray3_packet(box3_t b, const ray3_packet_t* p, uint32_t mask, float* tmin) {
+    float       tn[RAY3_PACKET_SIZE];
+    float       tf[RAY3_PACKET_SIZE];
+
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        bool    sx  = p->ix[i] < 0.0f;
+        bool    sy  = p->iy[i] < 0.0f;
+        bool    sz  = p->iz[i] < 0.0f;
+
+        float   x0  = ((sx ? b.max.x : b.min.x) - p->ox[i]) * p->ix[i];
+        float   x1  = ((sx ? b.min.x : b.max.x) - p->ox[i]) * p->ix[i];
+        float   y0  = ((sy ? b.max.y : b.min.y) - p->oy[i]) * p->iy[i];
+        float   y1  = ((sy ? b.min.y : b.max.y) - p->oy[i]) * p->iy[i];
+        float   z0  = ((sz ? b.max.z : b.min.z) - p->oz[i]) * p->iz[i];
+        float   z1  = ((sz ? b.min.z : b.max.z) - p->oz[i]) * p->iz[i];
+
+        float   n   = 0.0f;
+        float   f   = p->tmax[i];
+
+        n   = x0 > n ? x0 : n;      f   = x1 < f ? x1 : f;
+        n   = y0 > n ? y0 : n;      f   = y1 < f ? y1 : f;
+        n   = z0 > n ? z0 : n;      f   = z1 < f ? z1 : f;
+
+        tn[i]   = n;
+        tf[i]   = f;
+    }
+
+    uint32_t    hit_mask    = 0;
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        hit_mask    |= (tn[i] <= tf[i] ? 1u : 0u) << i;
+        if( tmin ) tmin[i] = tn[i];
+    }
+    return hit_mask & mask;
+}
+
+/* Moller-Trumbore, see ray3_tri3_intersection */
+uint32_t
+ray3_packet_tri3_intersection(ray3_packet_t* p, uint32_t mask, vec3_t v0, vec3_t v1, vec3_t v2, uint32_t tri, tri3_hit_t* hits) {
+    vec3_t      e1  = vec3_sub(v1, v0);
+    vec3_t      e2  = vec3_sub(v2, v0);
+
+    float       tt[RAY3_PACKET_SIZE];
+    float       uu[RAY3_PACKET_SIZE];
+    float       vv[RAY3_PACKET_SIZE];
+    int         ok[RAY3_PACKET_SIZE];
+
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        // pvec = direction x e2
+        float   px  = p->dy[i] * e2.z - p->dz[i] * e2.y;
+        float   py  = p->dz[i] * e2.x - p->dx[i] * e2.z;
+        float   pz  = p->dx[i] * e2.y - p->dy[i] * e2.x;
+        float   det = e1.x * px + e1.y * py + e1.z * pz;
+        float   inv = 1.0f / det;
+
+        // tvec = start - v0
+        float   tx  = p->ox[i] - v0.x;
+        float   ty  = p->oy[i] - v0.y;
+        float   tz  = p->oz[i] - v0.z;
+        float   u   = (tx * px + ty * py + tz * pz) * inv;
+
+        // qvec = tvec x e1
+        float   qx  = ty * e1.z - tz * e1.y;
+        float   qy  = tz * e1.x - tx * e1.z;
+        float   qz  = tx * e1.y - ty * e1.x;
+        float   v   = (p->dx[i] * qx + p->dy[i] * qy + p->dz[i] * qz) * inv;
+        float   t   = (e2.x * qx + e2.y * qy + e2.z * qz) * inv;
+
+        tt[i]   = t;
+        uu[i]   = u;
+        vv[i]   = v;
+        ok[i]   = (det > EPSILON * EPSILON || det < -EPSILON * EPSILON) &
+                  (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) &
+                  (t >= 0.0f) & (t < p->tmax[i]);
+    }
+
+    uint32_t    hit_mask    = 0;
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        hit_mask    |= (ok[i] ? 1u : 0u) << i;
+    }
+    hit_mask    &= mask;
+
+    for( uint32_t i = 0; i < RAY3_PACKET_SIZE; ++i ) {
+        if( hit_mask & (1u << i) ) {
+            p->tmax[i]      = tt[i];
+            hits[i].t       = tt[i];
+            hits[i].u       = uu[i];
+            hits[i].v       = vv[i];
+            hits[i].tri     = tri;
+        }
+    }
+    return hit_mask;
+}
+
+uint32_t
+tri3_group_build(tri3_group_t* groups, tri3_mesh_t mesh, const uint32_t* tris, uint32_t count) {
+    uint32_t    group_count = tri3_group_count(count);
+
+#pragma omp parallel for
+    for( int g = 0; g < (int)group_count; ++g ) {
+        tri3_group_t*   grp = &groups[g];
+        for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+            uint32_t    idx = (uint32_t)g * TRI3_GROUP_SIZE + i;
+            vec3_t      v0  = vec3(0.0f, 0.0f, 0.0f);
+            vec3_t      e1  = v0;
+            vec3_t      e2  = v0;
+            uint32_t    tri = UINT32_MAX;
+
+            if( idx < count ) {
+                vec3_t  v1, v2;
+                tri = tris ? tris[idx] : idx;
+                tri3_mesh_triangle(mesh, tri, &v0, &v1, &v2);
+                e1  = vec3_sub(v1, v0);
+                e2  = vec3_sub(v2, v0);
+            }
+
+            grp->v0x[i] = v0.x; grp->v0y[i] = v0.y; grp->v0z[i] = v0.z;
+            grp->e1x[i] = e1.x; grp->e1y[i] = e1.y; grp->e1z[i] = e1.z;
+            grp->e2x[i] = e2.x; grp->e2y[i] = e2.y; grp->e2z[i] = e2.z;
+            grp->tri[i] = tri;
+        }
+    }
+    return group_count;
+}
+
+/* Moller-Trumbore, one ray against all the lanes of a group */
+bool
+ray3_tri3_group_intersection(ray3_t r, const tri3_group_t* g, uint32_t lane_mask, float tmax, tri3_hit_t* hit) {
+    float       tt[TRI3_GROUP_SIZE];
+    float       uu[TRI3_GROUP_SIZE];
+    float       vv[TRI3_GROUP_SIZE];
+
+    for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+        // pvec = direction x e2
+        float   px  = r.direction.y * g->e2z[i] - r.direction.z * g->e2y[i];
+        float   py  = r.direction.z * g->e2x[i] - r.direction.x * g->e2z[i];
+        float   pz  = r.direction.x * g->e2y[i] - r.direction.y * g->e2x[i];
+        float   det = g->e1x[i] * px + g->e1y[i] * py + g->e1z[i] * pz;
+        float   inv = 1.0f / det;
+
+        // tvec = start - v0
+        float   tx  = r.start.x - g->v0x[i];
+        float   ty  = r.start.y - g->v0y[i];
+        float   tz  = r.start.z - g->v0z[i];
+        float   u   = (tx * px + ty * py + tz * pz) * inv;
+
+        // qvec = tvec x e1
+        float   qx  = ty * g->e1z[i] - tz * g->e1y[i];
+        float   qy  = tz * g->e1x[i] - tx * g->e1z[i];
+        float   qz  = tx * g->e1y[i] - ty * g->e1x[i];
+        float   v   = (r.direction.x * qx + r.direction.y * qy + r.direction.z * qz) * inv;
+        float   t   = (g->e2x[i] * qx + g->e2y[i] * qy + g->e2z[i] * qz) * inv;
+
+        bool    ok  = (det > EPSILON * EPSILON || det < -EPSILON * EPSILON) &
+                      (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) & (t >= 0.0f);
+
+        // misses are pushed to infinity so the nearest hit is a plain min reduction
+        tt[i]   = ok ? t : INFINITY;
+        uu[i]   = u;
+        vv[i]   = v;
+    }
+
+    uint32_t    best    = TRI3_GROUP_SIZE;
+    float       best_t  = tmax;
+    for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+        if( (lane_mask & (1u << i)) && tt[i] < best_t ) {
+            best_t  = tt[i];
+            best    = i;
+        }
+    }
+
+    if( best == TRI3_GROUP_SIZE ) return false;
+
+    hit->t      = tt[best];
+    hit->u      = uu[best];
+    hit->v      = vv[best];
+    hit->tri    = g->tri[best];
+    return true;
+}
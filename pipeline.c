@@ -0,0 +1,216 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <string.h>
+
+#define PIPELINE_CHUNK          1024    /* minimum triangles per parallel chunk */
+#define PIPELINE_MAX_CHUNKS     256
+#define PIPELINE_MAX_VERTICES   9       /* a triangle clipped by the 6 view planes */
+
+/*******************************************************************************
+** vertex stage
+*******************************************************************************/
+void
+transform_vec3_array(mat4_t m, const vec3_t* in, uint32_t count, vec4_t* out) {
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        vec3_t  p   = in[i];
+        out[i]  = vec4_add(vec4_add(vec4_mulf(m.col[0], p.x), vec4_mulf(m.col[1], p.y)),
+                           vec4_add(vec4_mulf(m.col[2], p.z), m.col[3]));
+    }
+}
+
+static INLINE
+uint8_t
+outcode(vec4_t v) {
+    return (uint8_t)((v.x < -v.w ? OUTCODE_LEFT : 0)   | (v.x > v.w ? OUTCODE_RIGHT : 0) |
+                     (v.y < -v.w ? OUTCODE_BOTTOM : 0) | (v.y > v.w ? OUTCODE_TOP : 0)   |
+                     (v.z < -v.w ? OUTCODE_NEAR : 0)   | (v.z > v.w ? OUTCODE_FAR : 0));
+}
+
+uint32_t
+clip_outcode_array(const vec4_t* in, uint32_t count, uint8_t* codes) {
+    uint32_t    all = count ? 0x3F : 0;
+
+    // the and of the codes is the and of the ors of any partition
+#pragma omp parallel
+    {
+        uint32_t    local   = 0x3F;
+#pragma omp for
+        for( int i = 0; i < (int)count; ++i ) {
+            codes[i]    = outcode(in[i]);
+            local       &= codes[i];
+        }
+#pragma omp atomic
+        all &= local;
+    }
+    return all;
+}
+
+/*******************************************************************************
+** triangle stage
+*******************************************************************************/
+/* signed distance to the clip plane of an outcode bit, inside when >= 0 */
+static INLINE
+float
+plane_distance4(vec4_t v, uint32_t bit) {
+    switch( bit ) {
+    case OUTCODE_LEFT:      return v.w + v.x;
+    case OUTCODE_RIGHT:     return v.w - v.x;
+    case OUTCODE_BOTTOM:    return v.w + v.y;
+    case OUTCODE_TOP:       return v.w - v.y;
+    case OUTCODE_NEAR:      return v.w + v.z;
+    default:                return v.w - v.z;
+    }
+}
+
+/* Sutherland-Hodgman in homogeneous space, cuts interpolate from the outside vertex for shared edges to match */
+static
+uint32_t
+clip_polygon4(const vec4_t* in, uint32_t count, uint32_t bit, vec4_t* out) {
+    uint32_t    n   = 0;
+    vec4_t      a   = in[count - 1];
+    float       da  = plane_distance4(a, bit);
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        vec4_t  b   = in[i];
+        float   db  = plane_distance4(b, bit);
+
+        if( (da < 0.0f) != (db < 0.0f) ) {
+            vec4_t  o   = da < 0.0f ? a : b;
+            vec4_t  p   = da < 0.0f ? b : a;
+            float   d0  = da < 0.0f ? da : db;
+            float   d1  = da < 0.0f ? db : da;
+            out[n++]    = vec4_add(o, vec4_mulf(vec4_sub(p, o), d0 / (d0 - d1)));
+        }
+        if( db >= 0.0f ) out[n++] = b;
+
+        a   = b;
+        da  = db;
+    }
+    return n;
+}
+
+/*
+ * clip, divide and cull a triangle, out NULL only counts. Facing is decided
+ * on the whole clipped polygon in normalized device coordinates (counter
+ * clockwise is front), so a flipped viewport does not change it.
+ */
+static
+uint32_t
+process_triangle(const vec4_t* clip, const uint8_t* codes, const uint32_t* idx, uint32_t tri, vec2_t lb, vec2_t rt, cull_mode_t cull, screen_tri_t* out) {
+    uint8_t     c0  = codes[idx[0]];
+    uint8_t     c1  = codes[idx[1]];
+    uint8_t     c2  = codes[idx[2]];
+
+    if( c0 & c1 & c2 ) return 0;
+
+    vec4_t      buf[2][PIPELINE_MAX_VERTICES];
+    vec4_t*     poly    = buf[0];
+    uint32_t    n       = 3;
+    uint32_t    cut     = c0 | c1 | c2;
+
+    poly[0] = clip[idx[0]];
+    poly[1] = clip[idx[1]];
+    poly[2] = clip[idx[2]];
+
+    for( uint32_t bit = 1; cut && bit <= OUTCODE_FAR; bit <<= 1 ) {
+        if( !(cut & bit) ) continue;
+        vec4_t* dst = poly == buf[0] ? buf[1] : buf[0];
+        n       = clip_polygon4(poly, n, bit, dst);
+        poly    = dst;
+        if( n < 3 ) return 0;
+    }
+
+    vec3_t      ndc[PIPELINE_MAX_VERTICES];
+    for( uint32_t i = 0; i < n; ++i ) {
+        if( poly[i].w <= 0.0f ) return 0;
+        float   iw  = 1.0f / poly[i].w;
+        ndc[i]  = vec3(poly[i].x * iw, poly[i].y * iw, poly[i].z * iw);
+    }
+
+    float   area    = 0.0f;
+    for( uint32_t i = 2; i < n; ++i )
+        area    += (ndc[i - 1].x - ndc[0].x) * (ndc[i].y - ndc[0].y) - (ndc[i].x - ndc[0].x) * (ndc[i - 1].y - ndc[0].y);
+    if( area == 0.0f || (cull == CULL_BACK && area < 0.0f) || (cull == CULL_FRONT && area > 0.0f) ) return 0;
+    if( !out ) return n - 2;
+
+    // same mapping as vec3_project
+    vec2_t  half    = vec2_mulf(vec2_sub(rt, lb), 0.5f);
+    for( uint32_t i = 0; i < n; ++i )
+        ndc[i]  = vec3(lb.x + half.x * (ndc[i].x + 1.0f), lb.y + half.y * (ndc[i].y + 1.0f), (ndc[i].z + 1.0f) * 0.5f);
+
+    for( uint32_t i = 2; i < n; ++i ) {
+        out[i - 2].v[0] = ndc[0];
+        out[i - 2].v[1] = ndc[i - 1];
+        out[i - 2].v[2] = ndc[i];
+        out[i - 2].tri  = tri;
+    }
+    return n - 2;
+}
+
+uint32_t
+clip_tri4_to_screen(const vec4_t* clip, const uint8_t* codes, const uint32_t* indices, uint32_t tri_count, vec2_t lb, vec2_t rt, cull_mode_t cull, screen_tri_t* out, uint32_t capacity) {
+    uint32_t    size    = (tri_count + PIPELINE_MAX_CHUNKS - 1) / PIPELINE_MAX_CHUNKS;
+    uint32_t    counts[PIPELINE_MAX_CHUNKS];
+    int         chunks;
+
+    size    = size > PIPELINE_CHUNK ? size : PIPELINE_CHUNK;
+    chunks  = (int)((tri_count + size - 1) / size);
+
+    // count, then write at the prefix offsets: the output order is the
+    // triangle order whatever the thread count, only straddlers clip twice
+#pragma omp parallel for schedule(dynamic)
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < tri_count ? begin + size : tri_count;
+        uint32_t    n       = 0;
+        for( uint32_t t = begin; t < end; ++t ) {
+            uint32_t    soup[3] = { t * 3, t * 3 + 1, t * 3 + 2 };
+            n   += process_triangle(clip, codes, indices ? &indices[t * 3] : soup, t, lb, rt, cull, NULL);
+        }
+        counts[c]   = n;
+    }
+
+    uint32_t    total   = 0;
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    n   = counts[c];
+        counts[c]   = total;
+        total       += n;
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for( int c = 0; c < chunks; ++c ) {
+        uint32_t    begin   = (uint32_t)c * size;
+        uint32_t    end     = begin + size < tri_count ? begin + size : tri_count;
+        uint32_t    at      = counts[c];
+        for( uint32_t t = begin; t < end && at < capacity; ++t ) {
+            uint32_t        soup[3] = { t * 3, t * 3 + 1, t * 3 + 2 };
+            screen_tri_t    tmp[PIPELINE_MAX_VERTICES - 2];
+            uint32_t        n       = process_triangle(clip, codes, indices ? &indices[t * 3] : soup, t, lb, rt, cull, tmp);
+            n   = at + n <= capacity ? n : capacity - at;
+            memcpy(&out[at], tmp, sizeof(screen_tri_t) * n);
+            at  += n;
+        }
+    }
+
+    return total;
+}
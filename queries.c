@@ -19,6 +19,8 @@
 #define BUILDING_3DMATH_DLL
 #include "3dmath.h"
 
+#include <stddef.h>
+
 #define EPSILON (1.0f / (1024.0f * 1024.f))
 
 ///
@@ -202,6 +204,60 @@ closest_point_on_segment3(segment3_t seg, vec3_t pt)  {
     return vec3_add(seg.s, vec3_mulf(seg_dir, t));
 }
 
+///
+/// closest point on a triangle by Voronoi region: the vertex and edge regions are
+/// tested first from the dot products of the edges with the point, the remaining
+/// case projects onto the face.
+///
+vec3_t
+closest_point_on_tri3(vec3_t v0, vec3_t v1, vec3_t v2, vec3_t pt, vec2_t* uv) {
+    vec3_t  e1  = vec3_sub(v1, v0);
+    vec3_t  e2  = vec3_sub(v2, v0);
+    vec3_t  p0  = vec3_sub(pt, v0);
+    float   d1  = vec3_dot(e1, p0);
+    float   d2  = vec3_dot(e2, p0);
+    float   u, v;
+
+    if( d1 <= 0.0f && d2 <= 0.0f ) {                   // vertex v0
+        u   = 0.0f;
+        v   = 0.0f;
+    } else {
+        vec3_t  p1  = vec3_sub(pt, v1);
+        float   d3  = vec3_dot(e1, p1);
+        float   d4  = vec3_dot(e2, p1);
+        vec3_t  p2  = vec3_sub(pt, v2);
+        float   d5  = vec3_dot(e1, p2);
+        float   d6  = vec3_dot(e2, p2);
+        float   vc  = d1 * d4 - d3 * d2;
+        float   vb  = d5 * d2 - d1 * d6;
+        float   va  = d3 * d6 - d5 * d4;
+
+        if( d3 >= 0.0f && d4 <= d3 ) {                 // vertex v1
+            u   = 1.0f;
+            v   = 0.0f;
+        } else if( d6 >= 0.0f && d5 <= d6 ) {           // vertex v2
+            u   = 0.0f;
+            v   = 1.0f;
+        } else if( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f ) {   // edge v0 v1
+            u   = d1 / (d1 - d3);
+            v   = 0.0f;
+        } else if( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f ) {   // edge v0 v2
+            u   = 0.0f;
+            v   = d2 / (d2 - d6);
+        } else if( va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f ) {   // edge v1 v2
+            v   = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            u   = 1.0f - v;
+        } else {                                        // face
+            float   denom   = 1.0f / (va + vb + vc);
+            u   = vb * denom;
+            v   = vc * denom;
+        }
+    }
+
+    if( uv ) *uv = vec2(u, v);
+    return vec3_add(v0, vec3_add(vec3_mulf(e1, u), vec3_mulf(e2, v)));
+}
+
 vec2_t
 closest_point_on_line2(line2_t l, vec2_t pt) {
     vec2_t  pt_dir  = vec2_sub(pt, l.p);
@@ -360,23 +416,23 @@ ray3_tri3_intersection(ray3_t r, vec3_t v0, vec3_t v1, vec3_t v2, vec3_t* out) {
 
     // calculate distance from vert0 to ray origin
     vec3_t	tvec = vec3_sub(r.start, v0);
-    //float	inv_det = 1.0f / det;
+    float	inv_det = 1.0f / det;
 
     vec3_t qvec = vec3_cross(tvec, edge1);
 
-    float u = vec3_dot(tvec, pvec) / det;
+    float u = vec3_dot(tvec, pvec) * inv_det;
 
     if (u < -EPSILON || u > 1.0f + EPSILON) {
         return false; // NoIntersection
     }
 
     // calculate V parameter and test bounds
-    float v = vec3_dot(r.direction, qvec) / det;
+    float v = vec3_dot(r.direction, qvec) * inv_det;
     if (v < -EPSILON || u + v > 1.0f + 2.0f * EPSILON) {
         return false; // NoIntersection
     }
 
-    float t = vec3_dot(edge2, qvec) / det;
+    float t = vec3_dot(edge2, qvec) * inv_det;
     *out = vec3_add(r.start, vec3_mulf(r.direction, t));
     return true; //Intersect
 }
@@ -403,31 +459,61 @@ intersect_box3_ray3(box3_t b, ray3_t r) {
     // "... Note also that since IEEE arithmetic guarantees that a positive number divided by zero
     // is +\infinity and a negative number divided by zero is -\infinity, the code works for vertical
     // and horizontal line ..."
-    float   tmin = -INFINITY, tmax = INFINITY;
-
-    float   t0, t1;
-
-    t0  = (b.min.x - r.start.x) / r.direction.x;
-    t1  = (b.max.x - r.start.x) / r.direction.x;
-
-    tmin    = MAX(tmin, MIN(t0, t1));
-    tmax    = MIN(tmax, MAX(t0, t1));
-
-    t0  = (b.min.y - r.start.y) / r.direction.y;
-    t1  = (b.max.y - r.start.y) / r.direction.y;
-
-    tmin    = MAX(tmin, MIN(t0, t1));
-    tmax    = MIN(tmax, MAX(t0, t1));
-
-
-    t0  = (b.min.z - r.start.z) / r.direction.z;
-    t1  = (b.max.z - r.start.z) / r.direction.z;
+    return intersect_box3_ray3_inv(b, ray3_inv(r), 0.0f, INFINITY, NULL, NULL);
+}
 
-    tmin    = MAX(tmin, MIN(t0, t1));
-    tmax    = MIN(tmax, MAX(t0, t1));
+///
+/// slab test with the precomputed reciprocal direction: the sign bits select which box
+/// bound is entered first on each axis, so no per axis min/max swap is needed.
+/// NaN slab distances (0 * inf, when the ray lies on a slab plane) fail the comparisons
+/// and are ignored.
+///
+static INLINE
+bool
+slab_test(box3_t b, ray3_inv_t r, float t0, float t1, float* tmin, float* tmax) {
+    float   tn  = t0;
+    float   tf  = t1;
+
+    float   tx0 = ((r.sign[0] ? b.max.x : b.min.x) - r.start.x) * r.inv_direction.x;
+    float   tx1 = ((r.sign[0] ? b.min.x : b.max.x) - r.start.x) * r.inv_direction.x;
+    float   ty0 = ((r.sign[1] ? b.max.y : b.min.y) - r.start.y) * r.inv_direction.y;
+    float   ty1 = ((r.sign[1] ? b.min.y : b.max.y) - r.start.y) * r.inv_direction.y;
+    float   tz0 = ((r.sign[2] ? b.max.z : b.min.z) - r.start.z) * r.inv_direction.z;
+    float   tz1 = ((r.sign[2] ? b.min.z : b.max.z) - r.start.z) * r.inv_direction.z;
+
+    tn  = tx0 > tn ? tx0 : tn;
+    tf  = tx1 < tf ? tx1 : tf;
+    tn  = ty0 > tn ? ty0 : tn;
+    tf  = ty1 < tf ? ty1 : tf;
+    tn  = tz0 > tn ? tz0 : tn;
+    tf  = tz1 < tf ? tz1 : tf;
+
+    *tmin   = tn;
+    *tmax   = tf;
+    return tn <= tf;
+}
 
+bool
+intersect_box3_ray3_inv(box3_t b, ray3_inv_t r, float t0, float t1, float* tmin, float* tmax) {
+    float   tn, tf;
+    bool    hit = slab_test(b, r, t0, t1, &tn, &tf);
+    if( tmin ) *tmin = tn;
+    if( tmax ) *tmax = tf;
+    return hit;
+}
 
-    return tmax > MAX(tmin, 0.0f);
+uint32_t
+intersect_box3_array_ray3_inv(const box3_t* boxes, uint32_t count, ray3_inv_t r, float t0, float t1, float* tmin, float* tmax, bool* hits) {
+    uint32_t    hit_count   = 0;
+    for( uint32_t i = 0; i < count; ++i ) {
+        float   tn, tf;
+        bool    hit = slab_test(boxes[i], r, t0, t1, &tn, &tf);
+        if( tmin ) tmin[i] = tn;
+        if( tmax ) tmax[i] = tf;
+        hits[i]     = hit;
+        hit_count   += hit ? 1 : 0;
+    }
+    return hit_count;
 }
 
 
@@ -459,3 +545,66 @@ intersect_tri3_sphere(vec3_t v0, vec3_t v1, vec3_t v2, vec3_t center, float radi
         }
     }
 }
+
+/* the triangle projects to [min(p), max(p)] on the axis, the box to [-r, r] */
+static INLINE
+bool
+separated(float p0, float p1, float p2, float r) {
+    return MIN(p0, MIN(p1, p2)) > r || MAX(p0, MAX(p1, p2)) < -r;
+}
+
+///
+/// separating axis test of a triangle against a box (Akenine-Moller): the 9 edge cross
+/// products first, then the 3 box face normals (the triangle bounds) and the triangle
+/// plane. Everything is computed relative to the box center.
+///
+bool
+intersect_box3_tri3(box3_t b, vec3_t v0, vec3_t v1, vec3_t v2) {
+    vec3_t  c   = box3_center(b);
+    vec3_t  h   = box3_extent(b);
+    vec3_t  a   = vec3_sub(v0, c);
+    vec3_t  bb  = vec3_sub(v1, c);
+    vec3_t  cc  = vec3_sub(v2, c);
+    vec3_t  e[3];
+    vec3_t  fe;
+
+    e[0]    = vec3_sub(bb, a);
+    e[1]    = vec3_sub(cc, bb);
+    e[2]    = vec3_sub(a, cc);
+
+    for( int i = 0; i < 3; ++i ) {
+        fe  = vec3(fabsf(e[i].x), fabsf(e[i].y), fabsf(e[i].z));
+
+        // axis x cross e: (0, -e.z, e.y)
+        float   p0  = a.z * e[i].y - a.y * e[i].z;
+        float   p1  = bb.z * e[i].y - bb.y * e[i].z;
+        float   p2  = cc.z * e[i].y - cc.y * e[i].z;
+        float   r   = h.y * fe.z + h.z * fe.y;
+        if( separated(p0, p1, p2, r) ) return false;
+
+        // axis y cross e: (e.z, 0, -e.x)
+        p0  = a.x * e[i].z - a.z * e[i].x;
+        p1  = bb.x * e[i].z - bb.z * e[i].x;
+        p2  = cc.x * e[i].z - cc.z * e[i].x;
+        r   = h.x * fe.z + h.z * fe.x;
+        if( separated(p0, p1, p2, r) ) return false;
+
+        // axis z cross e: (-e.y, e.x, 0)
+        p0  = a.y * e[i].x - a.x * e[i].y;
+        p1  = bb.y * e[i].x - bb.x * e[i].y;
+        p2  = cc.y * e[i].x - cc.x * e[i].y;
+        r   = h.x * fe.y + h.y * fe.x;
+        if( separated(p0, p1, p2, r) ) return false;
+    }
+
+    // box face normals
+    if( separated(a.x, bb.x, cc.x, h.x) ) return false;
+    if( separated(a.y, bb.y, cc.y, h.y) ) return false;
+    if( separated(a.z, bb.z, cc.z, h.z) ) return false;
+
+    // triangle plane
+    vec3_t  n   = vec3_cross(e[0], e[1]);
+    float   d   = vec3_dot(n, a);
+    float   r   = h.x * fabsf(n.x) + h.y * fabsf(n.y) + h.z * fabsf(n.z);
+    return fabsf(d) <= r;
+}
@@ -0,0 +1,254 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define RASTER_SUBPIXEL     16          /* vertex snapping, 4 bits */
+#define RASTER_BLOCK        8           /* block side, also the lane count */
+#define RASTER_TILE         64          /* tile side, a multiple of the block */
+#define RASTER_GUARD        1048576.0f  /* larger pixel coordinates are rejected, clip first */
+
+typedef struct {
+    int64_t     sa[3], sb[3], c[3];     /* edge at pixel (x, y): sa x + sb y + c */
+    int64_t     lo[3];                  /* 0 for owned edges (top-left), 1 otherwise */
+    float       z[3];
+    float       iw[3];
+    float       inv_area;
+    int         min_x, min_y, max_x, max_y;
+} raster_setup_t;
+
+void
+raster_clear(raster_target_t* t, float depth, uint32_t id) {
+    int     count   = t->width * t->height;
+#pragma omp parallel for
+    for( int i = 0; i < count; ++i ) {
+        if( t->depth ) t->depth[i] = depth;
+        if( t->ids ) t->ids[i] = id;
+    }
+}
+
+static INLINE
+int64_t
+floor_div(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/* false for triangles covering no pixel center of the target */
+static
+bool
+setup_triangle(const raster_target_t* t, const vec2_t* p, const float* z, const float* iw, raster_setup_t* s) {
+    int64_t     x[3], y[3];
+    int         order[3]    = { 0, 1, 2 };
+
+    for( int i = 0; i < 3; ++i ) {
+        if( !(fabsf(p[i].x) < RASTER_GUARD && fabsf(p[i].y) < RASTER_GUARD) ) return false;
+        x[i]    = (int64_t)lrintf(p[i].x * RASTER_SUBPIXEL);
+        y[i]    = (int64_t)lrintf(p[i].y * RASTER_SUBPIXEL);
+    }
+
+    int64_t     area    = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if( area == 0 ) return false;
+    if( area < 0 ) {
+        order[1]    = 2;
+        order[2]    = 1;
+        area        = -area;
+    }
+
+    int64_t     min_x   = MIN(x[0], MIN(x[1], x[2]));
+    int64_t     min_y   = MIN(y[0], MIN(y[1], y[2]));
+    int64_t     max_x   = MAX(x[0], MAX(x[1], x[2]));
+    int64_t     max_y   = MAX(y[0], MAX(y[1], y[2]));
+
+    // pixel centers inside the box, at subpixel 16 p + 8
+    s->min_x    = (int)MAX(floor_div(min_x - RASTER_SUBPIXEL / 2 + RASTER_SUBPIXEL - 1, RASTER_SUBPIXEL), 0);
+    s->min_y    = (int)MAX(floor_div(min_y - RASTER_SUBPIXEL / 2 + RASTER_SUBPIXEL - 1, RASTER_SUBPIXEL), 0);
+    s->max_x    = (int)MIN(floor_div(max_x - RASTER_SUBPIXEL / 2, RASTER_SUBPIXEL), (int64_t)t->width - 1);
+    s->max_y    = (int)MIN(floor_div(max_y - RASTER_SUBPIXEL / 2, RASTER_SUBPIXEL), (int64_t)t->height - 1);
+    if( s->min_x > s->max_x || s->min_y > s->max_y ) return false;
+
+    // the edge opposite a vertex, walked counter clockwise, over the doubled
+    // area is the barycentric coordinate of that vertex
+    for( int i = 0; i < 3; ++i ) {
+        int     v   = order[i];
+        int     a   = order[(i + 1) % 3];
+        int     b   = order[(i + 2) % 3];
+        int64_t dx  = x[b] - x[a];
+        int64_t dy  = y[b] - y[a];
+
+        s->sa[v]    = -dy * RASTER_SUBPIXEL;
+        s->sb[v]    = dx * RASTER_SUBPIXEL;
+        s->c[v]     = dy * x[a] - dx * y[a] + (dx - dy) * (RASTER_SUBPIXEL / 2);
+        s->lo[v]    = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+        s->z[v]     = z ? z[v] : 0.0f;
+        s->iw[v]    = iw ? iw[v] : 1.0f;
+    }
+    s->inv_area = 1.0f / (float)area;
+    return true;
+}
+
+static
+void
+shade_row(raster_target_t* t, const raster_setup_t* s, int x, int y, const int64_t e[3][RASTER_BLOCK], const bool* mask, uint32_t tri) {
+    float   l[3][RASTER_BLOCK];
+    float   z[RASTER_BLOCK];
+
+    for( int k = 0; k < RASTER_BLOCK; ++k ) {
+        l[0][k] = (float)e[0][k] * s->inv_area;
+        l[1][k] = (float)e[1][k] * s->inv_area;
+        l[2][k] = (float)e[2][k] * s->inv_area;
+        z[k]    = l[0][k] * s->z[0] + l[1][k] * s->z[1] + l[2][k] * s->z[2];
+    }
+
+    for( int k = 0; k < RASTER_BLOCK; ++k ) {
+        if( !mask[k] ) continue;
+
+        size_t  at  = (size_t)y * (size_t)t->width + (size_t)(x + k);
+        if( t->depth && !(z[k] < t->depth[at]) ) continue;
+
+        if( t->fragment ) {
+            vec3_t  b   = vec3(l[0][k] * s->iw[0], l[1][k] * s->iw[1], l[2][k] * s->iw[2]);
+            b   = vec3_mulf(b, 1.0f / (b.x + b.y + b.z));
+            if( !t->fragment(t->user, x + k, y, z[k], b, tri) ) continue;
+        }
+
+        if( t->depth ) t->depth[at] = z[k];
+        if( t->ids ) t->ids[at] = tri;
+    }
+}
+
+static
+void
+raster_in_tile(raster_target_t* t, const raster_setup_t* s, uint32_t tri, int tx0, int ty0) {
+    int     x0  = MAX(s->min_x, tx0);
+    int     y0  = MAX(s->min_y, ty0);
+    int     x1  = MIN(s->max_x, tx0 + RASTER_TILE - 1);
+    int     y1  = MIN(s->max_y, ty0 + RASTER_TILE - 1);
+
+    for( int by = y0 & ~(RASTER_BLOCK - 1); by <= y1; by += RASTER_BLOCK ) {
+        for( int bx = x0 & ~(RASTER_BLOCK - 1); bx <= x1; bx += RASTER_BLOCK ) {
+            int64_t e[3][RASTER_BLOCK];
+            bool    reject  = false;
+            bool    accept  = true;
+
+            // corner extremes of each edge over the block
+            for( int i = 0; i < 3; ++i ) {
+                int64_t e00 = s->sa[i] * bx + s->sb[i] * by + s->c[i];
+                int64_t ex  = s->sa[i] * (RASTER_BLOCK - 1);
+                int64_t ey  = s->sb[i] * (RASTER_BLOCK - 1);
+                int64_t emx = e00 + MAX(ex, 0) + MAX(ey, 0);
+                int64_t emn = e00 + MIN(ex, 0) + MIN(ey, 0);
+                reject  |= emx < s->lo[i];
+                accept  &= emn >= s->lo[i];
+                for( int k = 0; k < RASTER_BLOCK; ++k )
+                    e[i][k] = e00 + s->sa[i] * k;
+            }
+            if( reject ) continue;
+
+            for( int r = 0; r < RASTER_BLOCK; ++r ) {
+                int     y   = by + r;
+                bool    mask[RASTER_BLOCK];
+
+                if( y >= y0 && y <= y1 ) {
+                    bool    any = false;
+                    for( int k = 0; k < RASTER_BLOCK; ++k ) {
+                        mask[k] = bx + k >= x0 && bx + k <= x1 &&
+                                  (accept || (e[0][k] >= s->lo[0] && e[1][k] >= s->lo[1] && e[2][k] >= s->lo[2]));
+                        any     |= mask[k];
+                    }
+                    if( any ) shade_row(t, s, bx, y, (const int64_t (*)[RASTER_BLOCK])e, mask, tri);
+                }
+
+                for( int i = 0; i < 3; ++i )
+                    for( int k = 0; k < RASTER_BLOCK; ++k )
+                        e[i][k] += s->sb[i];
+            }
+        }
+    }
+}
+
+bool
+raster_tri2_array(raster_target_t* t, const vec2_t* points, const float* depths, const float* inv_w, uint32_t tri_count) {
+    int             tiles_x = (t->width + RASTER_TILE - 1) / RASTER_TILE;
+    int             tiles_y = (t->height + RASTER_TILE - 1) / RASTER_TILE;
+    int             tiles   = tiles_x * tiles_y;
+    raster_setup_t* setups;
+    bool*           valid;
+    uint32_t*       first;
+    uint32_t*       bins;
+
+    if( tri_count == 0 || tiles <= 0 ) return true;
+
+    setups  = (raster_setup_t*)malloc(sizeof(raster_setup_t) * tri_count);
+    valid   = (bool*)malloc(sizeof(bool) * tri_count);
+    first   = (uint32_t*)calloc((size_t)tiles + 1, sizeof(uint32_t));
+    if( !setups || !valid || !first ) {
+        free(setups);
+        free(valid);
+        free(first);
+        return false;
+    }
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)tri_count; ++i )
+        valid[i]    = setup_triangle(t, &points[i * 3], depths ? &depths[i * 3] : NULL, inv_w ? &inv_w[i * 3] : NULL, &setups[i]);
+
+    // bin in submission order so every tile resolves depth ties and ids like a serial pass
+    for( uint32_t i = 0; i < tri_count; ++i ) {
+        if( !valid[i] ) continue;
+        for( int ty = setups[i].min_y / RASTER_TILE; ty <= setups[i].max_y / RASTER_TILE; ++ty )
+            for( int tx = setups[i].min_x / RASTER_TILE; tx <= setups[i].max_x / RASTER_TILE; ++tx )
+                ++first[ty * tiles_x + tx + 1];
+    }
+    for( int i = 0; i < tiles; ++i )
+        first[i + 1]    += first[i];
+
+    bins    = (uint32_t*)malloc(sizeof(uint32_t) * (first[tiles] ? first[tiles] : 1));
+    if( !bins ) {
+        free(setups);
+        free(valid);
+        free(first);
+        return false;
+    }
+
+    for( uint32_t i = 0; i < tri_count; ++i ) {
+        if( !valid[i] ) continue;
+        for( int ty = setups[i].min_y / RASTER_TILE; ty <= setups[i].max_y / RASTER_TILE; ++ty )
+            for( int tx = setups[i].min_x / RASTER_TILE; tx <= setups[i].max_x / RASTER_TILE; ++tx )
+                bins[first[ty * tiles_x + tx]++] = i;
+    }
+
+    // the fill moved each start to the next one
+#pragma omp parallel for schedule(dynamic)
+    for( int tile = 0; tile < tiles; ++tile ) {
+        uint32_t    begin   = tile ? first[tile - 1] : 0;
+        int         tx0     = (tile % tiles_x) * RASTER_TILE;
+        int         ty0     = (tile / tiles_x) * RASTER_TILE;
+        for( uint32_t k = begin; k < first[tile]; ++k )
+            raster_in_tile(t, &setups[bins[k]], bins[k], tx0, ty0);
+    }
+
+    free(bins);
+    free(setups);
+    free(valid);
+    free(first);
+    return true;
+}
@@ -0,0 +1,154 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SAP_AXIS_HYSTERESIS 1.5     /* variance ratio needed to switch the sweep axis */
+
+static INLINE
+void
+set_endpoint(sap_endpoint_t* e, box3_t b, uint32_t axis) {
+    switch( axis ) {
+    case 0:     e->omin = vec3_yz(b.min); e->omax = vec3_yz(b.max); break;
+    case 1:     e->omin = vec3_xz(b.min); e->omax = vec3_xz(b.max); break;
+    default:    e->omin = vec3_xy(b.min); e->omax = vec3_xy(b.max); break;
+    }
+    e->min  = vec3_axis(b.min, axis);
+    e->max  = vec3_axis(b.max, axis);
+}
+
+static
+int
+compare_endpoints(const void* a, const void* b) {
+    float   ma  = ((const sap_endpoint_t*)a)->min;
+    float   mb  = ((const sap_endpoint_t*)b)->min;
+    return (ma > mb) - (ma < mb);
+}
+
+///
+/// axis with the largest variance of the box centers. The current axis is kept unless
+/// another one spreads more than SAP_AXIS_HYSTERESIS times as much, so near ties do not
+/// re-sort every frame.
+///
+static
+uint32_t
+spread_axis(const box3_t* boxes, uint32_t count, uint32_t current) {
+    double  sx = 0.0, sy = 0.0, sz = 0.0, sxx = 0.0, syy = 0.0, szz = 0.0;
+
+#pragma omp parallel for reduction(+:sx, sy, sz, sxx, syy, szz)
+    for( int i = 0; i < (int)count; ++i ) {
+        vec3_t  c   = box3_center(boxes[i]);
+        sx  += c.x;     sxx += (double)c.x * c.x;
+        sy  += c.y;     syy += (double)c.y * c.y;
+        sz  += c.z;     szz += (double)c.z * c.z;
+    }
+
+    double  n       = count ? (double)count : 1.0;
+    double  var[3]  = { sxx / n - (sx / n) * (sx / n), syy / n - (sy / n) * (sy / n), szz / n - (sz / n) * (sz / n) };
+    uint32_t    best    = var[0] >= var[1] && var[0] >= var[2] ? 0 : (var[1] >= var[2] ? 1 : 2);
+    return var[best] > SAP_AXIS_HYSTERESIS * var[current] ? best : current;
+}
+
+bool
+sap_init(sap_t* s, uint32_t axis, uint32_t capacity) {
+    memset(s, 0, sizeof(sap_t));
+    s->axis         = axis < 3 ? axis : 0;
+    s->capacity     = capacity ? capacity : 64;
+    s->endpoints    = (sap_endpoint_t*)malloc(sizeof(sap_endpoint_t) * s->capacity);
+    return s->endpoints != NULL;
+}
+
+void
+sap_release(sap_t* s) {
+    free(s->endpoints);
+    memset(s, 0, sizeof(sap_t));
+}
+
+bool
+sap_update(sap_t* s, const box3_t* boxes, uint32_t count) {
+    sap_endpoint_t* ep      = s->endpoints;
+    uint32_t        axis    = spread_axis(boxes, count, s->axis);
+
+    if( count != s->count || axis != s->axis ) {
+        if( count > s->capacity ) {
+            ep  = (sap_endpoint_t*)realloc(s->endpoints, sizeof(sap_endpoint_t) * count);
+            if( !ep ) return false;
+            s->endpoints    = ep;
+            s->capacity     = count;
+        }
+
+        s->axis = axis;
+        for( uint32_t i = 0; i < count; ++i ) {
+            set_endpoint(&ep[i], boxes[i], s->axis);
+            ep[i].box   = i;
+        }
+        qsort(ep, count, sizeof(sap_endpoint_t), compare_endpoints);
+        s->count    = count;
+        return true;
+    }
+
+#pragma omp parallel for
+    for( int i = 0; i < (int)count; ++i ) {
+        set_endpoint(&ep[i], boxes[ep[i].box], s->axis);
+    }
+
+    // insertion sort, close to linear with frame to frame coherence
+    for( uint32_t i = 1; i < count; ++i ) {
+        sap_endpoint_t  e   = ep[i];
+        uint32_t        j   = i;
+        while( j > 0 && ep[j - 1].min > e.min ) {
+            ep[j]   = ep[j - 1];
+            --j;
+        }
+        ep[j]   = e;
+    }
+    return true;
+}
+
+uint32_t
+sap_pairs(const sap_t* s, uint32_t* pairs, uint32_t max_pairs) {
+    const sap_endpoint_t*   ep      = s->endpoints;
+    uint32_t                found   = 0;
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for( int i = 0; i < (int)s->count; ++i ) {
+        sap_endpoint_t  e   = ep[i];
+
+        // every box starting before this one ends overlaps it on the sweep axis,
+        // most miss on the other axes: one combined test, no branch per axis
+        for( uint32_t j = (uint32_t)i + 1; j < s->count && ep[j].min <= e.max; ++j ) {
+            bool    miss    = (ep[j].omin.x > e.omax.x) | (ep[j].omax.x < e.omin.x) |
+                              (ep[j].omin.y > e.omax.y) | (ep[j].omax.y < e.omin.y);
+            if( miss ) continue;
+
+            uint32_t    slot;
+#pragma omp atomic capture
+            slot = found++;
+            if( slot < max_pairs ) {
+                pairs[2 * slot]     = e.box;
+                pairs[2 * slot + 1] = ep[j].box;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,366 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDF_NONE            UINT32_MAX
+#define SDF_SWEEP_PASSES    1   /* passes over the 8 sweep directions, a second one rarely improves anything */
+
+typedef struct {
+    const sdf_t*    sdf;
+    const bvh_t*    bvh;
+    uint32_t*       closest;    /* closest triangle of each sample, SDF_NONE if unknown */
+} bake_t;
+
+static INLINE
+float
+lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+static INLINE
+size_t
+sample_index(ivec3_t dims, int x, int y, int z) {
+    return ((size_t)z * (size_t)dims.y + (size_t)y) * (size_t)dims.x + (size_t)x;
+}
+
+static INLINE
+float
+sdf_at(const sdf_t* sdf, int x, int y, int z) {
+    return sdf->distance[sample_index(sdf->dims, x, y, z)];
+}
+
+static INLINE
+vec3_t
+sample_position(const sdf_t* sdf, int x, int y, int z) {
+    return vec3(sdf->domain.min.x + (float)x * sdf->cell.x,
+                sdf->domain.min.y + (float)y * sdf->cell.y,
+                sdf->domain.min.z + (float)z * sdf->cell.z);
+}
+
+static INLINE
+float
+tri_distance(const bvh_t* bvh, uint32_t tri, vec3_t p) {
+    vec3_t  v0, v1, v2;
+    tri3_mesh_triangle(bvh->mesh, tri, &v0, &v1, &v2);
+    return vec3_distance(closest_point_on_tri3(v0, v1, v2, p, NULL), p);
+}
+
+/* exact unsigned distances of the samples within band of the surface */
+static
+void
+narrow_band(bake_t* b, float band) {
+    const sdf_t*    sdf     = b->sdf;
+    ivec3_t         dims    = sdf->dims;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for( int z = 0; z < dims.z; ++z ) {
+        for( int y = 0; y < dims.y; ++y ) {
+            for( int x = 0; x < dims.x; ++x ) {
+                size_t          i   = sample_index(dims, x, y, z);
+                tri3_closest_t  c;
+                if( bvh_closest_point(b->bvh, sample_position(sdf, x, y, z), band, &c) ) {
+                    sdf->distance[i]    = c.distance;
+                    b->closest[i]       = c.tri;
+                } else {
+                    sdf->distance[i]    = INFINITY;
+                    b->closest[i]       = SDF_NONE;
+                }
+            }
+        }
+    }
+}
+
+static INLINE
+void
+check_neighbour(bake_t* b, size_t i, vec3_t p, int x, int y, int z) {
+    uint32_t    tri = b->closest[sample_index(b->sdf->dims, x, y, z)];
+    if( tri == SDF_NONE || tri == b->closest[i] ) return;
+
+    float       d   = tri_distance(b->bvh, tri, p);
+    if( d < b->sdf->distance[i] ) {
+        b->sdf->distance[i] = d;
+        b->closest[i]       = tri;
+    }
+}
+
+///
+/// one fast sweep in the direction (sx, sy, sz): every sample tries the closest triangles
+/// of its 7 upwind neighbours. The samples of a plane x' + y' + z' = level (in swept
+/// coordinates) only read from lower planes, so a plane is processed in parallel.
+///
+static
+void
+sweep(bake_t* b, int sx, int sy, int sz) {
+    ivec3_t     dims    = b->sdf->dims;
+    int         levels  = dims.x + dims.y + dims.z - 2;
+
+    for( int level = 1; level < levels; ++level ) {
+        int     z_lo    = level - (dims.x - 1) - (dims.y - 1);
+        int     z_hi    = level < dims.z - 1 ? level : dims.z - 1;
+
+#pragma omp parallel for schedule(static)
+        for( int kz = z_lo > 0 ? z_lo : 0; kz <= z_hi; ++kz ) {
+            int     y_lo    = level - kz - (dims.x - 1);
+            int     y_hi    = level - kz < dims.y - 1 ? level - kz : dims.y - 1;
+            for( int ky = y_lo > 0 ? y_lo : 0; ky <= y_hi; ++ky ) {
+                int     kx  = level - kz - ky;
+                int     x   = sx > 0 ? kx : dims.x - 1 - kx;
+                int     y   = sy > 0 ? ky : dims.y - 1 - ky;
+                int     z   = sz > 0 ? kz : dims.z - 1 - kz;
+                int     px  = x - sx;
+                int     py  = y - sy;
+                int     pz  = z - sz;
+                bool    bx  = kx > 0;
+                bool    by  = ky > 0;
+                bool    bz  = kz > 0;
+                size_t  i   = sample_index(dims, x, y, z);
+                vec3_t  p   = sample_position(b->sdf, x, y, z);
+
+                if( bx ) check_neighbour(b, i, p, px, y, z);
+                if( by ) check_neighbour(b, i, p, x, py, z);
+                if( bz ) check_neighbour(b, i, p, x, y, pz);
+                if( bx && by ) check_neighbour(b, i, p, px, py, z);
+                if( bx && bz ) check_neighbour(b, i, p, px, y, pz);
+                if( by && bz ) check_neighbour(b, i, p, x, py, pz);
+                if( bx && by && bz ) check_neighbour(b, i, p, px, py, pz);
+            }
+        }
+    }
+}
+
+/* 2d edge ownership for points exactly on an edge of a counter clockwise triangle */
+static INLINE
+bool
+owns_edge(double ax, double ay, double bx, double by) {
+    double  dx  = bx - ax;
+    double  dy  = by - ay;
+    return dy > 0.0 || (dy == 0.0 && dx < 0.0);
+}
+
+static INLINE
+bool
+edge_inside(double ax, double ay, double bx, double by, double px, double py) {
+    double  e   = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+    return e > 0.0 || (e == 0.0 && owns_edge(ax, ay, bx, by));
+}
+
+///
+/// crossing parity along an axis: every triangle toggles, in each grid column (u, v) its
+/// projection covers, the first sample past the crossing. A prefix xor along the column
+/// then gives the parity of the crossings before each sample, odd means inside. Columns
+/// exactly on a shared edge are owned by one triangle only.
+///
+static
+void
+axis_parity(const bake_t* b, int axis, uint8_t* parity, uint8_t* votes) {
+    const sdf_t*    sdf     = b->sdf;
+    ivec3_t         dims    = sdf->dims;
+    int             n[3]    = { dims.x, dims.y, dims.z };
+    int             au      = (axis + 1) % 3;
+    int             av      = (axis + 2) % 3;
+    float           lo[3]   = { sdf->domain.min.x, sdf->domain.min.y, sdf->domain.min.z };
+    float           cs[3]   = { sdf->cell.x, sdf->cell.y, sdf->cell.z };
+    size_t          stride[3];
+
+    stride[0]   = 1;
+    stride[1]   = (size_t)dims.x;
+    stride[2]   = (size_t)dims.x * (size_t)dims.y;
+
+    memset(parity, 0, stride[2] * (size_t)dims.z);
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for( int t = 0; t < (int)b->bvh->mesh.tri_count; ++t ) {
+        vec3_t  tv[3];
+        tri3_mesh_triangle(b->bvh->mesh, (uint32_t)t, &tv[0], &tv[1], &tv[2]);
+
+        double  u[3], v[3], w[3];
+        for( int k = 0; k < 3; ++k ) {
+            u[k]    = (double)vec3_axis(tv[k], au);
+            v[k]    = (double)vec3_axis(tv[k], av);
+            w[k]    = (double)vec3_axis(tv[k], axis);
+        }
+
+        double  area    = (u[1] - u[0]) * (v[2] - v[0]) - (v[1] - v[0]) * (u[2] - u[0]);
+        if( area == 0.0 ) continue;     // edge on, the neighbours account for the crossing
+        if( area < 0.0 ) {
+            double  tmp;
+            tmp = u[1]; u[1] = u[2]; u[2] = tmp;
+            tmp = v[1]; v[1] = v[2]; v[2] = tmp;
+            tmp = w[1]; w[1] = w[2]; w[2] = tmp;
+            area    = -area;
+        }
+
+        double  umin    = MIN(u[0], MIN(u[1], u[2]));
+        double  umax    = MAX(u[0], MAX(u[1], u[2]));
+        double  vmin    = MIN(v[0], MIN(v[1], v[2]));
+        double  vmax    = MAX(v[0], MAX(v[1], v[2]));
+        int     iu0     = (int)ceil((umin - lo[au]) / cs[au]);
+        int     iu1     = (int)floor((umax - lo[au]) / cs[au]);
+        int     iv0     = (int)ceil((vmin - lo[av]) / cs[av]);
+        int     iv1     = (int)floor((vmax - lo[av]) / cs[av]);
+        iu0 = iu0 > 0 ? iu0 : 0;
+        iv0 = iv0 > 0 ? iv0 : 0;
+        iu1 = iu1 < n[au] - 1 ? iu1 : n[au] - 1;
+        iv1 = iv1 < n[av] - 1 ? iv1 : n[av] - 1;
+
+        for( int iv = iv0; iv <= iv1; ++iv ) {
+            for( int iu = iu0; iu <= iu1; ++iu ) {
+                // same float expression as sample_position, so every triangle sees the same column
+                double  pu  = (double)(lo[au] + (float)iu * cs[au]);
+                double  pv  = (double)(lo[av] + (float)iv * cs[av]);
+                if( !edge_inside(u[0], v[0], u[1], v[1], pu, pv) ||
+                    !edge_inside(u[1], v[1], u[2], v[2], pu, pv) ||
+                    !edge_inside(u[2], v[2], u[0], v[0], pu, pv) ) continue;
+
+                double  b1  = ((u[2] - u[0]) * (pv - v[0]) - (v[2] - v[0]) * (pu - u[0])) / -area;
+                double  b2  = ((u[1] - u[0]) * (pv - v[0]) - (v[1] - v[0]) * (pu - u[0])) / area;
+                double  d   = w[0] + b1 * (w[1] - w[0]) + b2 * (w[2] - w[0]);
+                double  fi  = ceil((d - lo[axis]) / cs[axis]);
+                int     iw  = fi < 0.0 ? 0 : (fi >= (double)n[axis] ? n[axis] : (int)fi);
+                if( iw == n[axis] ) continue;
+
+                size_t  idx = (size_t)iu * stride[au] + (size_t)iv * stride[av] + (size_t)iw * stride[axis];
+#pragma omp atomic
+                parity[idx] ^= 1;
+            }
+        }
+    }
+
+#pragma omp parallel for
+    for( int iv = 0; iv < n[av]; ++iv ) {
+        for( int iu = 0; iu < n[au]; ++iu ) {
+            size_t  idx = (size_t)iu * stride[au] + (size_t)iv * stride[av];
+            uint8_t acc = 0;
+            for( int iw = 0; iw < n[axis]; ++iw, idx += stride[axis] ) {
+                acc         ^= parity[idx];
+                votes[idx]  += acc;
+            }
+        }
+    }
+}
+
+bool
+sdf_bake(sdf_t* sdf, tri3_mesh_t mesh, box3_t domain, ivec3_t dims, uint32_t band) {
+    memset(sdf, 0, sizeof(sdf_t));
+    if( mesh.tri_count == 0 || dims.x < 2 || dims.y < 2 || dims.z < 2 ) return false;
+
+    size_t  count   = (size_t)dims.x * (size_t)dims.y * (size_t)dims.z;
+    vec3_t  ext     = vec3_sub(domain.max, domain.min);
+
+    sdf->domain     = domain;
+    sdf->dims       = dims;
+    sdf->cell       = vec3(ext.x / (float)(dims.x - 1), ext.y / (float)(dims.y - 1), ext.z / (float)(dims.z - 1));
+    sdf->inv_cell   = vec3(1.0f / sdf->cell.x, 1.0f / sdf->cell.y, 1.0f / sdf->cell.z);
+    sdf->distance   = (float*)malloc(sizeof(float) * count);
+
+    bvh_t       bvh;
+    bake_t      b;
+    uint8_t*    parity  = (uint8_t*)malloc(count);
+    uint8_t*    votes   = (uint8_t*)calloc(count, 1);
+    b.sdf       = sdf;
+    b.bvh       = &bvh;
+    b.closest   = (uint32_t*)malloc(sizeof(uint32_t) * count);
+
+    bool        ok      = sdf->distance && parity && votes && b.closest && bvh_build_tri3(&bvh, mesh, 4);
+    if( ok ) {
+        float   cell    = MAX(sdf->cell.x, MAX(sdf->cell.y, sdf->cell.z));
+        narrow_band(&b, (float)(band ? band : 1) * cell);
+
+        for( int pass = 0; pass < SDF_SWEEP_PASSES; ++pass ) {
+            for( int dir = 0; dir < 8; ++dir ) {
+                sweep(&b, dir & 1 ? -1 : 1, dir & 2 ? -1 : 1, dir & 4 ? -1 : 1);
+            }
+        }
+
+        for( int axis = 0; axis < 3; ++axis ) {
+            axis_parity(&b, axis, parity, votes);
+        }
+
+#pragma omp parallel for
+        for( long long i = 0; i < (long long)count; ++i ) {
+            if( votes[i] >= 2 ) sdf->distance[i] = -sdf->distance[i];
+        }
+
+        bvh_release(&bvh);
+    }
+
+    free(b.closest);
+    free(votes);
+    free(parity);
+    if( !ok ) sdf_release(sdf);
+    return ok;
+}
+
+void
+sdf_release(sdf_t* sdf) {
+    free(sdf->distance);
+    memset(sdf, 0, sizeof(sdf_t));
+}
+
+/* cell and fractional position of p, clamped to the domain */
+static INLINE
+void
+locate(const sdf_t* sdf, vec3_t p, int c[3], float f[3]) {
+    vec3_t  q   = vec3_mul(vec3_sub(p, sdf->domain.min), sdf->inv_cell);
+    int     n[3]    = { sdf->dims.x, sdf->dims.y, sdf->dims.z };
+    float   g[3]    = { q.x, q.y, q.z };
+    for( int k = 0; k < 3; ++k ) {
+        float   t   = g[k] < 0.0f ? 0.0f : (g[k] > (float)(n[k] - 1) ? (float)(n[k] - 1) : g[k]);
+        int     i   = (int)t;
+        c[k]    = i < n[k] - 2 ? i : n[k] - 2;
+        f[k]    = t - (float)c[k];
+    }
+}
+
+float
+sdf_sample(const sdf_t* sdf, vec3_t p) {
+    int     c[3];
+    float   f[3];
+    locate(sdf, p, c, f);
+
+    float   d00 = lerp(sdf_at(sdf, c[0], c[1], c[2]),         sdf_at(sdf, c[0] + 1, c[1], c[2]),         f[0]);
+    float   d10 = lerp(sdf_at(sdf, c[0], c[1] + 1, c[2]),     sdf_at(sdf, c[0] + 1, c[1] + 1, c[2]),     f[0]);
+    float   d01 = lerp(sdf_at(sdf, c[0], c[1], c[2] + 1),     sdf_at(sdf, c[0] + 1, c[1], c[2] + 1),     f[0]);
+    float   d11 = lerp(sdf_at(sdf, c[0], c[1] + 1, c[2] + 1), sdf_at(sdf, c[0] + 1, c[1] + 1, c[2] + 1), f[0]);
+    return lerp(lerp(d00, d10, f[1]), lerp(d01, d11, f[1]), f[2]);
+}
+
+vec3_t
+sdf_gradient(const sdf_t* sdf, vec3_t p) {
+    int     c[3];
+    float   f[3];
+    locate(sdf, p, c, f);
+
+    float   d[8];
+    for( int k = 0; k < 8; ++k ) {
+        d[k]    = sdf_at(sdf, c[0] + (k & 1), c[1] + ((k >> 1) & 1), c[2] + ((k >> 2) & 1));
+    }
+
+    // derivatives of the trilinear interpolant along each axis
+    float   gx  = lerp(lerp(d[1] - d[0], d[3] - d[2], f[1]), lerp(d[5] - d[4], d[7] - d[6], f[1]), f[2]);
+    float   gy  = lerp(lerp(d[2] - d[0], d[3] - d[1], f[0]), lerp(d[6] - d[4], d[7] - d[5], f[0]), f[2]);
+    float   gz  = lerp(lerp(d[4] - d[0], d[5] - d[1], f[0]), lerp(d[6] - d[2], d[7] - d[3], f[0]), f[1]);
+    return vec3_mul(vec3(gx, gy, gz), sdf->inv_cell);
+}
@@ -0,0 +1,401 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <math.h>
+#include <stddef.h>
+
+#define EPSILON (1.0f / (1024.0f * 1024.f))
+
+/*******************************************************************************
+** closest points
+*******************************************************************************/
+static INLINE
+float
+clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* Ericson, real-time collision detection 5.1.9 */
+float
+segment3_segment3_closest(segment3_t s0, segment3_t s1, vec3_t* out0, vec3_t* out1) {
+    vec3_t  d0  = vec3_sub(s0.e, s0.s);
+    vec3_t  d1  = vec3_sub(s1.e, s1.s);
+    vec3_t  r   = vec3_sub(s0.s, s1.s);
+    float   a   = vec3_dot(d0, d0);
+    float   e   = vec3_dot(d1, d1);
+    float   f   = vec3_dot(d1, r);
+    float   s, t;
+
+    if( a <= EPSILON && e <= EPSILON ) {
+        s   = 0.0f;
+        t   = 0.0f;
+    } else if( a <= EPSILON ) {
+        s   = 0.0f;
+        t   = clampf(f / e, 0.0f, 1.0f);
+    } else {
+        float   c   = vec3_dot(d0, r);
+        if( e <= EPSILON ) {
+            t   = 0.0f;
+            s   = clampf(-c / a, 0.0f, 1.0f);
+        } else {
+            float   b       = vec3_dot(d0, d1);
+            float   denom   = a * e - b * b;
+
+            // parallel segments pick s = 0
+            s   = denom != 0.0f ? clampf((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+            t   = (b * s + f) / e;
+            if( t < 0.0f ) {
+                t   = 0.0f;
+                s   = clampf(-c / a, 0.0f, 1.0f);
+            } else if( t > 1.0f ) {
+                t   = 1.0f;
+                s   = clampf((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    vec3_t  c0  = vec3_add(s0.s, vec3_mulf(d0, s));
+    vec3_t  c1  = vec3_add(s1.s, vec3_mulf(d1, t));
+    if( out0 ) *out0 = c0;
+    if( out1 ) *out1 = c1;
+
+    vec3_t  d   = vec3_sub(c0, c1);
+    return vec3_dot(d, d);
+}
+
+vec3_t
+closest_point_on_obb3(obb3_t o, vec3_t pt) {
+    vec3_t  l   = obb3_to_local(o, pt);
+    vec3_t  c   = o.center;
+    c   = vec3_add(c, vec3_mulf(o.axes.col[0], clampf(l.x, -o.extents.x, o.extents.x)));
+    c   = vec3_add(c, vec3_mulf(o.axes.col[1], clampf(l.y, -o.extents.y, o.extents.y)));
+    c   = vec3_add(c, vec3_mulf(o.axes.col[2], clampf(l.z, -o.extents.z, o.extents.z)));
+    return c;
+}
+
+///
+/// squared distance of the local segment a + t d, t in [0, 1], to the box [-h, h]. The
+/// distance is a convex piecewise quadratic in t whose pieces change where the segment
+/// crosses a slab plane, each piece is minimized in closed form.
+///
+static
+float
+segment_box_sqr_distance(vec3_t a, vec3_t d, vec3_t h) {
+    float   pa[3]   = { a.x, a.y, a.z };
+    float   pd[3]   = { d.x, d.y, d.z };
+    float   ph[3]   = { h.x, h.y, h.z };
+    float   ts[8];
+    int     count   = 0;
+
+    ts[count++] = 0.0f;
+    ts[count++] = 1.0f;
+    for( int i = 0; i < 3; ++i ) {
+        if( pd[i] == 0.0f ) continue;
+        float   t0  = (-ph[i] - pa[i]) / pd[i];
+        float   t1  = ( ph[i] - pa[i]) / pd[i];
+        if( t0 > 0.0f && t0 < 1.0f ) ts[count++] = t0;
+        if( t1 > 0.0f && t1 < 1.0f ) ts[count++] = t1;
+    }
+
+    // insertion sort of the breakpoints
+    for( int i = 1; i < count; ++i ) {
+        float   v   = ts[i];
+        int     j   = i;
+        for( ; j > 0 && ts[j - 1] > v; --j ) ts[j] = ts[j - 1];
+        ts[j]   = v;
+    }
+
+    float   best    = INFINITY;
+    for( int k = 0; k + 1 < count; ++k ) {
+        float   lo  = ts[k];
+        float   hi  = ts[k + 1];
+        float   tm  = 0.5f * (lo + hi);
+        float   qa  = 0.0f, qb = 0.0f, qc = 0.0f;
+
+        // sum of the (a + t d - bound)^2 terms of the axes outside their slab on this piece
+        for( int i = 0; i < 3; ++i ) {
+            float   p   = pa[i] + tm * pd[i];
+            float   o   = p > ph[i] ? pa[i] - ph[i] : (p < -ph[i] ? pa[i] + ph[i] : 0.0f);
+            if( p > ph[i] || p < -ph[i] ) {
+                qa  += pd[i] * pd[i];
+                qb  += 2.0f * pd[i] * o;
+                qc  += o * o;
+            }
+        }
+
+        float   t   = qa > 0.0f ? clampf(-qb / (2.0f * qa), lo, hi) : lo;
+        float   v   = (qa * t + qb) * t + qc;
+        best    = v < best ? v : best;
+        if( best <= 0.0f ) return 0.0f;
+    }
+
+    return best;
+}
+
+/*******************************************************************************
+** overlaps
+*******************************************************************************/
+bool
+intersect_sphere_sphere(sphere_t a, sphere_t b) {
+    vec3_t  d   = vec3_sub(a.center, b.center);
+    float   r   = a.radius + b.radius;
+    return vec3_dot(d, d) <= r * r;
+}
+
+bool
+intersect_sphere_capsule(sphere_t s, capsule_t c) {
+    vec3_t  d   = vec3_sub(s.center, closest_point_on_segment3(c.axis, s.center));
+    float   r   = s.radius + c.radius;
+    return vec3_dot(d, d) <= r * r;
+}
+
+bool
+intersect_sphere_obb3(sphere_t s, obb3_t o) {
+    vec3_t  d   = vec3_sub(s.center, closest_point_on_obb3(o, s.center));
+    return vec3_dot(d, d) <= s.radius * s.radius;
+}
+
+bool
+intersect_capsule_capsule(capsule_t a, capsule_t b) {
+    float   r   = a.radius + b.radius;
+    return segment3_segment3_closest(a.axis, b.axis, NULL, NULL) <= r * r;
+}
+
+bool
+intersect_capsule_obb3(capsule_t c, obb3_t o) {
+    vec3_t  a   = obb3_to_local(o, c.axis.s);
+    vec3_t  b   = obb3_to_local(o, c.axis.e);
+    return segment_box_sqr_distance(a, vec3_sub(b, a), o.extents) <= c.radius * c.radius;
+}
+
+/* Ericson 4.4.1, the epsilon guards the cross products of near parallel edges */
+bool
+intersect_obb3_obb3(obb3_t a, obb3_t b) {
+    float   ra, rb;
+    float   R[3][3], AbsR[3][3];
+    float   ea[3]   = { a.extents.x, a.extents.y, a.extents.z };
+    float   eb[3]   = { b.extents.x, b.extents.y, b.extents.z };
+
+    for( int i = 0; i < 3; ++i ) {
+        for( int j = 0; j < 3; ++j ) {
+            R[i][j]     = vec3_dot(a.axes.col[i], b.axes.col[j]);
+            AbsR[i][j]  = fabsf(R[i][j]) + EPSILON;
+        }
+    }
+
+    vec3_t  d   = vec3_sub(b.center, a.center);
+    float   t[3];
+    t[0]    = vec3_dot(d, a.axes.col[0]);
+    t[1]    = vec3_dot(d, a.axes.col[1]);
+    t[2]    = vec3_dot(d, a.axes.col[2]);
+
+    // axes of a
+    for( int i = 0; i < 3; ++i ) {
+        ra  = ea[i];
+        rb  = eb[0] * AbsR[i][0] + eb[1] * AbsR[i][1] + eb[2] * AbsR[i][2];
+        if( fabsf(t[i]) > ra + rb ) return false;
+    }
+
+    // axes of b
+    for( int j = 0; j < 3; ++j ) {
+        ra  = ea[0] * AbsR[0][j] + ea[1] * AbsR[1][j] + ea[2] * AbsR[2][j];
+        rb  = eb[j];
+        if( fabsf(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]) > ra + rb ) return false;
+    }
+
+    // a_i x b_j
+    for( int i = 0; i < 3; ++i ) {
+        int     i1  = (i + 1) % 3;
+        int     i2  = (i + 2) % 3;
+        for( int j = 0; j < 3; ++j ) {
+            int     j1  = (j + 1) % 3;
+            int     j2  = (j + 2) % 3;
+            ra  = ea[i1] * AbsR[i2][j] + ea[i2] * AbsR[i1][j];
+            rb  = eb[j1] * AbsR[i][j2] + eb[j2] * AbsR[i][j1];
+            if( fabsf(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb ) return false;
+        }
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+** ray casts
+*******************************************************************************/
+bool
+ray3_sphere_intersection(ray3_t r, sphere_t s, float* t) {
+    vec3_t  m   = vec3_sub(r.start, s.center);
+    float   a   = vec3_dot(r.direction, r.direction);
+    float   b   = vec3_dot(m, r.direction);
+    float   c   = vec3_dot(m, m) - s.radius * s.radius;
+
+    if( c <= 0.0f ) {
+        *t  = 0.0f;
+        return true;
+    }
+
+    float   disc    = b * b - a * c;
+    if( b > 0.0f || disc < 0.0f || a <= 0.0f ) return false;
+
+    *t  = (-b - sqrtf(disc)) / a;
+    return true;
+}
+
+bool
+ray3_capsule_intersection(ray3_t r, capsule_t c, float* t) {
+    vec3_t  d   = vec3_sub(c.axis.e, c.axis.s);
+    vec3_t  m   = vec3_sub(r.start, c.axis.s);
+    vec3_t  n   = r.direction;
+    float   dd  = vec3_dot(d, d);
+    float   md  = vec3_dot(m, d);
+    float   nd  = vec3_dot(n, d);
+    float   rr  = c.radius * c.radius;
+    float   best    = INFINITY;
+    float   tc;
+
+    // starts inside
+    vec3_t  w   = vec3_sub(r.start, closest_point_on_segment3(c.axis, r.start));
+    if( vec3_dot(w, w) <= rr ) {
+        *t  = 0.0f;
+        return true;
+    }
+
+    // side of the cylinder, then the two end caps
+    float   qa  = dd * vec3_dot(n, n) - nd * nd;
+    float   qb  = 2.0f * (dd * vec3_dot(m, n) - md * nd);
+    float   qc  = dd * (vec3_dot(m, m) - rr) - md * md;
+    float   disc    = qb * qb - 4.0f * qa * qc;
+    if( dd > 0.0f && qa > 0.0f && disc >= 0.0f ) {
+        float   tt  = (-qb - sqrtf(disc)) / (2.0f * qa);
+        float   s   = (md + tt * nd) / dd;
+        if( tt >= 0.0f && s >= 0.0f && s <= 1.0f ) best = tt;
+    }
+
+    if( ray3_sphere_intersection(r, sphere(c.axis.s, c.radius), &tc) && tc < best ) best = tc;
+    if( ray3_sphere_intersection(r, sphere(c.axis.e, c.radius), &tc) && tc < best ) best = tc;
+
+    if( best == INFINITY ) return false;
+    *t  = best;
+    return true;
+}
+
+bool
+ray3_obb3_intersection(ray3_t r, obb3_t o, float* t) {
+    vec3_t  start   = obb3_to_local(o, r.start);
+    vec3_t  dir     = vec3(vec3_dot(r.direction, o.axes.col[0]),
+                           vec3_dot(r.direction, o.axes.col[1]),
+                           vec3_dot(r.direction, o.axes.col[2]));
+    box3_t  b;
+    b.min   = vec3_neg(o.extents);
+    b.max   = o.extents;
+    float   tn;
+    if( !intersect_box3_ray3_inv(b, ray3_inv(ray3_from(start, dir)), 0.0f, INFINITY, &tn, NULL) ) return false;
+    *t  = tn;
+    return true;
+}
+
+/*******************************************************************************
+** batches
+*******************************************************************************/
+uint32_t
+intersect_sphere_array_sphere(const sphere_t* spheres, uint32_t count, sphere_t s, bool* hits) {
+    uint32_t    n   = 0;
+    for( uint32_t i = 0; i < count; ++i ) {
+        float   dx  = spheres[i].center.x - s.center.x;
+        float   dy  = spheres[i].center.y - s.center.y;
+        float   dz  = spheres[i].center.z - s.center.z;
+        float   r   = spheres[i].radius + s.radius;
+        hits[i] = dx * dx + dy * dy + dz * dz <= r * r;
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_sphere_array_ray3(const sphere_t* spheres, uint32_t count, ray3_t r, float* t, bool* hits) {
+    uint32_t    n   = 0;
+    float       tc  = 0.0f;
+    for( uint32_t i = 0; i < count; ++i ) {
+        hits[i] = ray3_sphere_intersection(r, spheres[i], &tc);
+        if( t && hits[i] ) t[i] = tc;
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_capsule_array_sphere(const capsule_t* capsules, uint32_t count, sphere_t s, bool* hits) {
+    uint32_t    n   = 0;
+    for( uint32_t i = 0; i < count; ++i ) {
+        hits[i] = intersect_sphere_capsule(s, capsules[i]);
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_capsule_array_ray3(const capsule_t* capsules, uint32_t count, ray3_t r, float* t, bool* hits) {
+    uint32_t    n   = 0;
+    float       tc  = 0.0f;
+    for( uint32_t i = 0; i < count; ++i ) {
+        hits[i] = ray3_capsule_intersection(r, capsules[i], &tc);
+        if( t && hits[i] ) t[i] = tc;
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_obb3_array_sphere(const obb3_t* obbs, uint32_t count, sphere_t s, bool* hits) {
+    uint32_t    n   = 0;
+    for( uint32_t i = 0; i < count; ++i ) {
+        hits[i] = intersect_sphere_obb3(s, obbs[i]);
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_obb3_array_obb3(const obb3_t* obbs, uint32_t count, obb3_t o, bool* hits) {
+    uint32_t    n   = 0;
+    float       ro  = vec3_length(o.extents);
+    for( uint32_t i = 0; i < count; ++i ) {
+        // bounding sphere rejection before the separating axis test
+        vec3_t  d   = vec3_sub(obbs[i].center, o.center);
+        float   r   = ro + vec3_length(obbs[i].extents);
+        hits[i] = vec3_dot(d, d) <= r * r && intersect_obb3_obb3(obbs[i], o);
+        n       += hits[i];
+    }
+    return n;
+}
+
+uint32_t
+intersect_obb3_array_ray3(const obb3_t* obbs, uint32_t count, ray3_t r, float* t, bool* hits) {
+    uint32_t    n   = 0;
+    float       tc  = 0.0f;
+    for( uint32_t i = 0; i < count; ++i ) {
+        hits[i] = ray3_obb3_intersection(r, obbs[i], &tc);
+        if( t && hits[i] ) t[i] = tc;
+        n       += hits[i];
+    }
+    return n;
+}
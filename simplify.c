@@ -0,0 +1,604 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_NONE           0xFFFFFFFFu
+#define SIMPLIFY_BORDER_WEIGHT  10.0    /* border constraint planes, over the squared edge length */
+#define SIMPLIFY_MAX_TURN       0.25f   /* cosine of the largest normal change of a moved face */
+
+/* vertex kinds */
+#define KIND_MANIFOLD           0       /* collapses to any neighbour */
+#define KIND_BORDER             1       /* collapses along its border only */
+#define KIND_LOCKED             2       /* attribute seam or non manifold, never moves */
+#define KIND_REMOVED            3
+
+/* edge kinds of a half-edge */
+#define EDGE_INNER              0
+#define EDGE_BORDER             1
+#define EDGE_COMPLEX            2
+
+/* symmetric 4x4 plane quadric and its total weight */
+typedef struct {
+    double      a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+    double      w;
+} quadric_t;
+
+/*
+ * Corner table: the half-edge of corner c runs from its vertex to the next
+ * corner's in the triangle, next and previous are implicit (3 t + k) and each
+ * vertex links its corners in a ring, so a half-edge costs 3 words (vertex,
+ * wedge, ring link) and the twin is found by walking a ring.
+ */
+typedef struct {
+    uint32_t*       remap;          /* input vertex -> position vertex */
+    uint32_t*       unique;         /* position vertex -> first input vertex */
+    vec3_t*         positions;      /* per position vertex */
+    uint32_t        count;
+    uint8_t*        edges;          /* corner -> kind of its half-edge */
+    uint32_t*       pid;            /* corner -> position vertex */
+    uint32_t*       wedge;          /* corner -> input vertex */
+    uint32_t*       ring;           /* corner -> next corner of the same position vertex */
+    uint32_t*       head;
+    uint32_t*       tail;
+    uint8_t*        dead;           /* per triangle */
+    uint8_t*        kind;
+    uint8_t*        stale;          /* best collapse to recheck for validity */
+    quadric_t*      q;
+
+    // per vertex stamps: neighbours of the evaluated vertex, candidates
+    // tried, common neighbours counted, re-evaluated after a collapse
+    uint32_t*       mark;
+    uint32_t*       tried;
+    uint32_t*       seen;
+    uint32_t*       fresh;
+    uint32_t        stamp;
+
+    // indexed min heap of the best collapse of each vertex
+    uint32_t*       heap;
+    uint32_t*       slot;
+    float*          cost;
+    uint32_t*       target;
+    uint32_t        heap_size;
+} simplify_t;
+
+static INLINE uint32_t  corner_next(uint32_t c)     { return c - c % 3 + (c + 1) % 3; }
+static INLINE uint32_t  corner_prev(uint32_t c)     { return c - c % 3 + (c + 2) % 3; }
+
+static INLINE
+void
+quadric_plane(quadric_t* q, double a, double b, double c, double d, double w) {
+    q->a00  = w * a * a;    q->a01  = w * a * b;    q->a02  = w * a * c;    q->a03  = w * a * d;
+    q->a11  = w * b * b;    q->a12  = w * b * c;    q->a13  = w * b * d;
+    q->a22  = w * c * c;    q->a23  = w * c * d;
+    q->a33  = w * d * d;
+    q->w    = w;
+}
+
+static INLINE
+void
+quadric_add(quadric_t* q, const quadric_t* r) {
+    q->a00  += r->a00;  q->a01  += r->a01;  q->a02  += r->a02;  q->a03  += r->a03;
+    q->a11  += r->a11;  q->a12  += r->a12;  q->a13  += r->a13;
+    q->a22  += r->a22;  q->a23  += r->a23;
+    q->a33  += r->a33;
+    q->w    += r->w;
+}
+
+/* weighted sum of squared plane distances */
+static INLINE
+double
+quadric_eval(const quadric_t* q, vec3_t p) {
+    double  x   = p.x, y = p.y, z = p.z;
+    return q->a00 * x * x + 2.0 * (q->a01 * x * y + q->a02 * x * z + q->a03 * x) +
+           q->a11 * y * y + 2.0 * (q->a12 * y * z + q->a13 * y) +
+           q->a22 * z * z + 2.0 * q->a23 * z + q->a33;
+}
+
+/* squared mean distance of a vertex moved onto target to the planes of both */
+static INLINE
+float
+collapse_cost(const simplify_t* s, uint32_t u, uint32_t v) {
+    double      w   = s->q[u].w + s->q[v].w;
+    double      e   = w > 0.0 ? (quadric_eval(&s->q[u], s->positions[v]) + quadric_eval(&s->q[v], s->positions[v])) / w : 0.0;
+    return e > 0.0 ? (float)e : 0.0f;
+}
+
+static INLINE
+vec3_t
+triangle_cross(vec3_t a, vec3_t b, vec3_t c) {
+    return vec3_cross(vec3_sub(b, a), vec3_sub(c, a));
+}
+
+/*******************************************************************************
+** setup
+*******************************************************************************/
+/* edge kind of the half-edge of corner c, read only on the rings */
+static
+uint8_t
+edge_kind(const simplify_t* s, uint32_t c) {
+    uint32_t    a       = s->pid[c];
+    uint32_t    b       = s->pid[corner_next(c)];
+    uint32_t    same    = 0;
+    uint32_t    twins   = 0;
+
+    for( uint32_t k = s->head[a]; k != SIMPLIFY_NONE; k = s->ring[k] )
+        if( !s->dead[k / 3] && s->pid[corner_next(k)] == b ) ++same;
+    for( uint32_t k = s->head[b]; k != SIMPLIFY_NONE; k = s->ring[k] )
+        if( !s->dead[k / 3] && s->pid[corner_next(k)] == a ) ++twins;
+
+    if( same != 1 || twins > 1 ) return EDGE_COMPLEX;
+    return twins ? EDGE_INNER : EDGE_BORDER;
+}
+
+/* plane quadrics of the ring faces (area weighted) and border constraints */
+static
+void
+vertex_quadric(simplify_t* s, uint32_t v) {
+    quadric_t   q;
+
+    memset(&s->q[v], 0, sizeof(quadric_t));
+    for( uint32_t c = s->head[v]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+
+        vec3_t  p0  = s->positions[s->pid[c]];
+        vec3_t  p1  = s->positions[s->pid[corner_next(c)]];
+        vec3_t  p2  = s->positions[s->pid[corner_prev(c)]];
+        vec3_t  n   = triangle_cross(p0, p1, p2);
+        double  len = vec3_length(n);
+        if( len == 0.0 ) continue;
+
+        n   = vec3_mulf(n, (float)(1.0 / len));
+        quadric_plane(&q, n.x, n.y, n.z, -vec3_dot(n, p0), 0.5 * len);
+        quadric_add(&s->q[v], &q);
+
+        // the border edges leaving and reaching the vertex in this face
+        for( int k = 0; k < 2; ++k ) {
+            uint32_t    e   = k ? corner_prev(c) : c;
+            if( s->edges[e] != EDGE_BORDER ) continue;
+
+            vec3_t  a   = s->positions[s->pid[e]];
+            vec3_t  d   = vec3_sub(s->positions[s->pid[corner_next(e)]], a);
+            vec3_t  m   = vec3_cross(d, n);
+            double  ml  = vec3_length(m);
+            if( ml == 0.0 ) continue;
+
+            m   = vec3_mulf(m, (float)(1.0 / ml));
+            quadric_plane(&q, m.x, m.y, m.z, -vec3_dot(m, a), SIMPLIFY_BORDER_WEIGHT * vec3_dot(d, d));
+            quadric_add(&s->q[v], &q);
+        }
+    }
+}
+
+static
+uint8_t
+vertex_kind(const simplify_t* s, uint32_t v) {
+    uint32_t    borders = 0;
+    uint32_t    w       = SIMPLIFY_NONE;
+
+    for( uint32_t c = s->head[v]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        if( w == SIMPLIFY_NONE ) w = s->wedge[c];
+        // two attribute sets on one position: a seam
+        if( s->wedge[c] != w ) return KIND_LOCKED;
+        if( s->edges[c] == EDGE_COMPLEX || s->edges[corner_prev(c)] == EDGE_COMPLEX ) return KIND_LOCKED;
+        borders += s->edges[c] == EDGE_BORDER;
+    }
+    if( w == SIMPLIFY_NONE ) return KIND_REMOVED;
+    // more than one border fan pinched in this vertex
+    if( borders > 1 ) return KIND_LOCKED;
+    return borders ? KIND_BORDER : KIND_MANIFOLD;
+}
+
+/*******************************************************************************
+** collapse evaluation
+*******************************************************************************/
+/* triangles of the ring of u holding v, and the wedge of v they agree on */
+static
+uint32_t
+shared_triangles(const simplify_t* s, uint32_t u, uint32_t v, uint32_t* wedge) {
+    uint32_t    shared  = 0;
+
+    *wedge  = SIMPLIFY_NONE;
+    for( uint32_t c = s->head[u]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        uint32_t    k   = s->pid[corner_next(c)] == v ? corner_next(c) : (s->pid[corner_prev(c)] == v ? corner_prev(c) : SIMPLIFY_NONE);
+        if( k == SIMPLIFY_NONE ) continue;
+        if( *wedge != SIMPLIFY_NONE && *wedge != s->wedge[k] ) return SIMPLIFY_NONE;
+        *wedge  = s->wedge[k];
+        ++shared;
+    }
+    return shared;
+}
+
+/* the neighbours of u must be marked with stamp */
+static
+bool
+collapse_valid(simplify_t* s, uint32_t u, uint32_t v, uint32_t stamp) {
+    uint32_t    seen    = ++s->stamp;
+    uint32_t    wedge;
+    uint32_t    shared  = shared_triangles(s, u, v, &wedge);
+    uint32_t    common  = 0;
+
+    if( shared == 0 || shared > 2 || shared == SIMPLIFY_NONE ) return false;
+    if( s->kind[u] == KIND_BORDER && shared != 1 ) return false;
+
+    // link condition: the only common neighbours are the opposite vertices
+    // of the shared triangles, anything else pinches the surface
+    for( uint32_t c = s->head[v]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        for( int k = 0; k < 2; ++k ) {
+            uint32_t    n   = s->pid[k ? corner_prev(c) : corner_next(c)];
+            if( n == u || s->mark[n] != stamp || s->seen[n] == seen ) continue;
+            s->seen[n]  = seen;
+            ++common;
+        }
+    }
+    if( common != shared ) return false;
+
+    // no face of u may flip, fold or degenerate once moved onto v
+    vec3_t      pv  = s->positions[v];
+    for( uint32_t c = s->head[u]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        uint32_t    b   = s->pid[corner_next(c)];
+        uint32_t    d   = s->pid[corner_prev(c)];
+        if( b == v || d == v ) continue;
+
+        vec3_t      pb  = s->positions[b];
+        vec3_t      pd  = s->positions[d];
+        vec3_t      n0  = triangle_cross(s->positions[u], pb, pd);
+        vec3_t      n1  = triangle_cross(pv, pb, pd);
+        if( vec3_dot(n0, n1) <= SIMPLIFY_MAX_TURN * vec3_length(n0) * vec3_length(n1) ) return false;
+    }
+    return true;
+}
+
+/* cheapest valid collapse of u, FLT_MAX without one */
+static
+void
+evaluate(simplify_t* s, uint32_t u) {
+    uint32_t    stamp   = ++s->stamp;
+
+    s->cost[u]      = FLT_MAX;
+    s->target[u]    = SIMPLIFY_NONE;
+    s->stale[u]     = 0;
+    if( s->kind[u] != KIND_MANIFOLD && s->kind[u] != KIND_BORDER ) return;
+
+    // the link test needs the neighbours of u marked
+    for( uint32_t c = s->head[u]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        s->mark[s->pid[corner_next(c)]] = stamp;
+        s->mark[s->pid[corner_prev(c)]] = stamp;
+    }
+
+    for( uint32_t c = s->head[u]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        for( int k = 0; k < 2; ++k ) {
+            uint32_t    v   = s->pid[k ? corner_prev(c) : corner_next(c)];
+            if( s->tried[v] == stamp ) continue;
+            s->tried[v] = stamp;
+
+            float   e   = collapse_cost(s, u, v);
+            if( e < s->cost[u] && collapse_valid(s, u, v, stamp) ) {
+                s->cost[u]      = e;
+                s->target[u]    = v;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+** indexed heap
+*******************************************************************************/
+static
+void
+heap_swap(simplify_t* s, uint32_t a, uint32_t b) {
+    uint32_t    va  = s->heap[a];
+    uint32_t    vb  = s->heap[b];
+    s->heap[a]  = vb;
+    s->heap[b]  = va;
+    s->slot[vb] = a;
+    s->slot[va] = b;
+}
+
+static
+void
+heap_up(simplify_t* s, uint32_t i) {
+    while( i > 0 && s->cost[s->heap[(i - 1) / 2]] > s->cost[s->heap[i]] ) {
+        heap_swap(s, i, (i - 1) / 2);
+        i   = (i - 1) / 2;
+    }
+}
+
+static
+void
+heap_down(simplify_t* s, uint32_t i) {
+    for( ;; ) {
+        uint32_t    l   = 2 * i + 1;
+        uint32_t    m   = i;
+        if( l < s->heap_size && s->cost[s->heap[l]] < s->cost[s->heap[m]] ) m = l;
+        if( l + 1 < s->heap_size && s->cost[s->heap[l + 1]] < s->cost[s->heap[m]] ) m = l + 1;
+        if( m == i ) return;
+        heap_swap(s, i, m);
+        i   = m;
+    }
+}
+
+/* after a cost change, vertices without a collapse leave the heap */
+static
+void
+heap_update(simplify_t* s, uint32_t v) {
+    uint32_t    i   = s->slot[v];
+
+    if( s->target[v] == SIMPLIFY_NONE ) {
+        if( i == SIMPLIFY_NONE ) return;
+        heap_swap(s, i, --s->heap_size);
+        s->slot[v]  = SIMPLIFY_NONE;
+        if( i < s->heap_size ) {
+            heap_up(s, i);
+            heap_down(s, i);
+        }
+        return;
+    }
+
+    if( i == SIMPLIFY_NONE ) {
+        i               = s->heap_size++;
+        s->heap[i]      = v;
+        s->slot[v]      = i;
+    }
+    heap_up(s, i);
+    heap_down(s, s->slot[v]);
+}
+
+/*******************************************************************************
+** simplification
+*******************************************************************************/
+/* move u onto v, returns the triangles removed */
+static
+uint32_t
+collapse(simplify_t* s, uint32_t u, uint32_t v) {
+    uint32_t    wedge;
+    uint32_t    removed = 0;
+
+    shared_triangles(s, u, v, &wedge);
+    for( uint32_t c = s->head[u]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        if( s->pid[corner_next(c)] == v || s->pid[corner_prev(c)] == v ) {
+            s->dead[c / 3]  = 1;
+            ++removed;
+            continue;
+        }
+        s->pid[c]   = v;
+        s->wedge[c] = wedge;
+    }
+
+    // splice the ring of u into v's, dropping the dead corners of both
+    if( s->head[u] != SIMPLIFY_NONE ) {
+        if( s->head[v] == SIMPLIFY_NONE ) s->head[v] = s->head[u];
+        else s->ring[s->tail[v]] = s->head[u];
+        s->tail[v]  = s->tail[u];
+    }
+    s->head[u]  = s->tail[u] = SIMPLIFY_NONE;
+
+    uint32_t    last    = SIMPLIFY_NONE;
+    for( uint32_t c = s->head[v]; c != SIMPLIFY_NONE; c = s->ring[c] ) {
+        if( s->dead[c / 3] ) continue;
+        if( last == SIMPLIFY_NONE ) s->head[v] = c;
+        else s->ring[last] = c;
+        last    = c;
+    }
+    if( last == SIMPLIFY_NONE ) s->head[v] = SIMPLIFY_NONE;
+    else s->ring[last] = SIMPLIFY_NONE;
+    s->tail[v]  = last;
+
+    quadric_add(&s->q[v], &s->q[u]);
+    s->kind[u]  = KIND_REMOVED;
+    return removed;
+}
+
+static
+void
+simplify_release(simplify_t* s) {
+    free(s->remap);
+    free(s->unique);
+    free(s->positions);
+    free(s->edges);
+    free(s->pid);
+    free(s->wedge);
+    free(s->ring);
+    free(s->dead);
+    free(s->head);
+    free(s->tail);
+    free(s->kind);
+    free(s->q);
+    free(s->mark);
+    free(s->tried);
+    free(s->seen);
+    free(s->fresh);
+    free(s->stale);
+    free(s->heap);
+    free(s->slot);
+    free(s->cost);
+    free(s->target);
+    memset(s, 0, sizeof(simplify_t));
+}
+
+/* topology on welded positions, input vertices stay wedges */
+static
+bool
+simplify_init(simplify_t* s, tri3_mesh_t mesh, uint32_t vertex_count) {
+    uint32_t    corner_count    = mesh.tri_count * 3;
+    uint32_t    count;
+
+    memset(s, 0, sizeof(simplify_t));
+    s->remap    = (uint32_t*)malloc(sizeof(uint32_t) * (vertex_count ? vertex_count : 1));
+    s->unique   = (uint32_t*)malloc(sizeof(uint32_t) * (vertex_count ? vertex_count : 1));
+    if( !s->remap || !s->unique || corner_count == 0 ) return false;
+
+    count       = weld_vertices(mesh.vertices, NULL, NULL, vertex_count, 0.0f, 0.0f, 0.0f, s->remap, s->unique);
+    s->positions= (vec3_t*)malloc(sizeof(vec3_t) * (count + 1));
+    s->edges    = (uint8_t*)malloc(corner_count);
+    s->pid      = (uint32_t*)malloc(sizeof(uint32_t) * corner_count);
+    s->wedge    = (uint32_t*)malloc(sizeof(uint32_t) * corner_count);
+    s->ring     = (uint32_t*)malloc(sizeof(uint32_t) * corner_count);
+    s->dead     = (uint8_t*)calloc(mesh.tri_count, 1);
+    s->head     = (uint32_t*)malloc(sizeof(uint32_t) * (count + 1));
+    s->tail     = (uint32_t*)malloc(sizeof(uint32_t) * (count + 1));
+    s->kind     = (uint8_t*)malloc(count + 1);
+    s->q        = (quadric_t*)malloc(sizeof(quadric_t) * (count + 1));
+    s->mark     = (uint32_t*)calloc(count + 1, sizeof(uint32_t));
+    s->tried    = (uint32_t*)calloc(count + 1, sizeof(uint32_t));
+    s->seen     = (uint32_t*)calloc(count + 1, sizeof(uint32_t));
+    s->fresh    = (uint32_t*)calloc(count + 1, sizeof(uint32_t));
+    s->stale    = (uint8_t*)calloc(count + 1, 1);
+    s->heap     = (uint32_t*)malloc(sizeof(uint32_t) * (count + 1));
+    s->slot     = (uint32_t*)malloc(sizeof(uint32_t) * (count + 1));
+    s->cost     = (float*)malloc(sizeof(float) * (count + 1));
+    s->target   = (uint32_t*)malloc(sizeof(uint32_t) * (count + 1));
+    s->count    = count;
+    return count && s->positions && s->edges && s->pid && s->wedge && s->ring && s->dead && s->head && s->tail && s->kind && s->q &&
+           s->mark && s->tried && s->seen && s->fresh && s->stale && s->heap && s->slot && s->cost && s->target;
+}
+
+uint32_t
+tri3_mesh_simplify(tri3_mesh_t mesh, uint32_t vertex_count, uint32_t target_tri_count, float target_error, uint32_t* out_indices, float* out_error) {
+    simplify_t  s;
+    uint32_t    corner_count    = mesh.tri_count * 3;
+    uint32_t    live            = 0;
+    uint32_t    out             = 0;
+    float       max_error       = 0.0f;
+    float       limit           = target_error * target_error;
+
+    if( out_error ) *out_error = 0.0f;
+    if( !simplify_init(&s, mesh, vertex_count) ) {
+        simplify_release(&s);
+        return 0;
+    }
+
+    weld_gather_vec3(mesh.vertices, s.unique, s.count, s.positions);
+
+#pragma omp parallel for
+    for( int c = 0; c < (int)corner_count; ++c ) {
+        s.wedge[c]  = mesh.indices ? mesh.indices[c] : (uint32_t)c;
+        s.pid[c]    = s.remap[s.wedge[c]];
+    }
+
+    // rings in corner order, degenerate input triangles are dropped
+    for( uint32_t v = 0; v < s.count; ++v )
+        s.head[v]   = s.tail[v] = SIMPLIFY_NONE;
+    for( uint32_t t = 0; t < mesh.tri_count; ++t ) {
+        uint32_t    a   = s.pid[t * 3], b = s.pid[t * 3 + 1], c = s.pid[t * 3 + 2];
+        if( a == b || b == c || c == a ) {
+            s.dead[t]   = 1;
+            continue;
+        }
+        ++live;
+        for( uint32_t k = t * 3; k < t * 3 + 3; ++k ) {
+            uint32_t    v   = s.pid[k];
+            s.ring[k]   = SIMPLIFY_NONE;
+            if( s.head[v] == SIMPLIFY_NONE ) s.head[v] = k;
+            else s.ring[s.tail[v]] = k;
+            s.tail[v]   = k;
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for( int c = 0; c < (int)corner_count; ++c )
+        s.edges[c]  = s.dead[c / 3] ? EDGE_INNER : edge_kind(&s, (uint32_t)c);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for( int v = 0; v < (int)s.count; ++v ) {
+        s.kind[v]   = vertex_kind(&s, (uint32_t)v);
+        vertex_quadric(&s, (uint32_t)v);
+    }
+
+    // the evaluation stamps are shared, the first costs are computed in order
+    for( uint32_t v = 0; v < s.count; ++v ) {
+        evaluate(&s, v);
+        s.slot[v]   = SIMPLIFY_NONE;
+        if( s.target[v] != SIMPLIFY_NONE ) {
+            s.slot[v]               = s.heap_size;
+            s.heap[s.heap_size++]   = v;
+        }
+    }
+    for( uint32_t i = s.heap_size / 2; i-- > 0; )
+        heap_down(&s, i);
+
+    while( live > target_tri_count && s.heap_size ) {
+        uint32_t    u   = s.heap[0];
+
+        // a stale cost is exact but its collapse may have become invalid,
+        // refresh it before it is compared to the limit or collapsed
+        if( s.stale[u] ) {
+            evaluate(&s, u);
+            heap_update(&s, u);
+            continue;
+        }
+
+        uint32_t    v   = s.target[u];
+        float       e   = s.cost[u];
+        if( e > limit ) break;
+
+        live        -= collapse(&s, u, v);
+        max_error   = MAX(max_error, e);
+
+        s.target[u] = SIMPLIFY_NONE;
+        heap_update(&s, u);
+
+        // every vertex whose best collapse may have changed now neighbours v.
+        // Costs are means over the summed quadric weights, merging into v can
+        // lower them as well as raise them, but only the collapses onto v
+        // changed: a neighbour whose best collapse is elsewhere and still
+        // cheaper keeps its exact cost and is only rechecked for validity
+        uint32_t    round   = ++s.stamp;
+        evaluate(&s, v);
+        heap_update(&s, v);
+        s.fresh[v]  = round;
+        for( uint32_t c = s.head[v]; c != SIMPLIFY_NONE; c = s.ring[c] ) {
+            for( int k = 0; k < 2; ++k ) {
+                uint32_t    n   = s.pid[k ? corner_prev(c) : corner_next(c)];
+                if( s.fresh[n] == round ) continue;
+                s.fresh[n]  = round;
+                if( s.slot[n] != SIMPLIFY_NONE && s.target[n] != u && s.target[n] != v && collapse_cost(&s, n, v) >= s.cost[n] ) {
+                    s.stale[n]  = 1;
+                } else if( s.slot[n] != SIMPLIFY_NONE || s.kind[n] == KIND_MANIFOLD || s.kind[n] == KIND_BORDER ) {
+                    evaluate(&s, n);
+                    heap_update(&s, n);
+                }
+            }
+        }
+    }
+
+    for( uint32_t t = 0; t < mesh.tri_count; ++t ) {
+        if( s.dead[t] ) continue;
+        out_indices[out * 3]        = s.wedge[t * 3];
+        out_indices[out * 3 + 1]    = s.wedge[t * 3 + 1];
+        out_indices[out * 3 + 2]    = s.wedge[t * 3 + 2];
+        ++out;
+    }
+    if( out_error ) *out_error = sqrtf(max_error);
+
+    simplify_release(&s);
+    return out;
+}
@@ -0,0 +1,86 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#define SKIN_LANES              8       /* vertices blended and transformed together */
+#define SKIN_PARALLEL_MIN       4096    /* fewer vertices stay on the calling thread */
+
+void
+skin_vertices(const mat4_t* palette, const uint16_t* joints, const float* weights, uint32_t influences, const vec3_t* positions, const vec3_t* normals, uint32_t count, vec3_t* out_positions, vec3_t* out_normals) {
+    int     blocks  = (int)((count + SKIN_LANES - 1) / SKIN_LANES);
+
+    // static blocks of lanes: each thread streams one contiguous range
+#pragma omp parallel for schedule(static) if(count >= SKIN_PARALLEL_MIN)
+    for( int b = 0; b < blocks; ++b ) {
+        uint32_t    first   = (uint32_t)b * SKIN_LANES;
+        uint32_t    n       = MIN(count - first, SKIN_LANES);
+        float       m[12][SKIN_LANES];      /* blended affine columns, element 3 c + r */
+        float       x[SKIN_LANES], y[SKIN_LANES], z[SKIN_LANES];
+
+        for( int e = 0; e < 12; ++e )
+            for( int l = 0; l < SKIN_LANES; ++l )
+                m[e][l] = 0.0f;
+
+        for( uint32_t l = 0; l < n; ++l ) {
+            const uint16_t* j   = &joints[(size_t)(first + l) * influences];
+            const float*    w   = &weights[(size_t)(first + l) * influences];
+            for( uint32_t k = 0; k < influences; ++k ) {
+                if( w[k] == 0.0f ) continue;
+                const mat4_t*   p   = &palette[j[k]];
+                for( int c = 0; c < 4; ++c ) {
+                    m[c * 3][l]     += w[k] * p->m[c][0];
+                    m[c * 3 + 1][l] += w[k] * p->m[c][1];
+                    m[c * 3 + 2][l] += w[k] * p->m[c][2];
+                }
+            }
+        }
+
+        // unused lanes transform zeros and are not stored
+        for( int l = 0; l < SKIN_LANES; ++l ) {
+            vec3_t  p   = (uint32_t)l < n ? positions[first + l] : vec3(0.0f, 0.0f, 0.0f);
+            x[l]    = m[0][l] * p.x + m[3][l] * p.y + m[6][l] * p.z + m[9][l];
+            y[l]    = m[1][l] * p.x + m[4][l] * p.y + m[7][l] * p.z + m[10][l];
+            z[l]    = m[2][l] * p.x + m[5][l] * p.y + m[8][l] * p.z + m[11][l];
+        }
+        for( uint32_t l = 0; l < n; ++l )
+            out_positions[first + l]    = vec3(x[l], y[l], z[l]);
+
+        if( !normals || !out_normals ) continue;
+
+        for( int l = 0; l < SKIN_LANES; ++l ) {
+            vec3_t  v   = (uint32_t)l < n ? normals[first + l] : vec3(0.0f, 0.0f, 1.0f);
+            x[l]    = m[0][l] * v.x + m[3][l] * v.y + m[6][l] * v.z;
+            y[l]    = m[1][l] * v.x + m[4][l] * v.y + m[7][l] * v.z;
+            z[l]    = m[2][l] * v.x + m[5][l] * v.y + m[8][l] * v.z;
+        }
+        for( int l = 0; l < SKIN_LANES; ++l ) {
+            float   len = sqrtf(x[l] * x[l] + y[l] * y[l] + z[l] * z[l]);
+            float   inv = len > 0.0f ? 1.0f / len : 0.0f;
+            x[l]    *= inv;
+            y[l]    *= inv;
+            z[l]    *= inv;
+        }
+        for( uint32_t l = 0; l < n; ++l )
+            out_normals[first + l]  = vec3(x[l], y[l], z[l]);
+    }
+}
@@ -0,0 +1,252 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <math.h>
+#include <stddef.h>
+
+/* smallest root of a t^2 + b t + c = 0 if it lies in [0, tmax], a start in contact is handled by the callers */
+static INLINE
+bool
+lowest_root(float a, float b, float c, float tmax, float* root) {
+    float   disc    = b * b - 4.0f * a * c;
+    if( a <= 0.0f || disc < 0.0f ) return false;
+
+    float   sq      = sqrtf(disc);
+    float   inv     = 0.5f / a;
+    float   r0      = (-b - sq) * inv;
+    if( r0 < 0.0f || r0 > tmax ) return false;
+
+    *root   = r0;
+    return true;
+}
+
+/* sphere against a vertex, c0 is the sphere center at t = 0 */
+static
+bool
+sweep_vertex(vec3_t c0, float r, vec3_t m, vec3_t v, float tmax, float* t) {
+    vec3_t  d   = vec3_sub(c0, v);
+    return lowest_root(vec3_dot(m, m), 2.0f * vec3_dot(m, d), vec3_dot(d, d) - r * r, tmax, t);
+}
+
+/* sphere against the segment [p0, p1], the quadratic is the distance to the line without the edge component */
+static
+bool
+sweep_edge(vec3_t c0, float r, vec3_t m, vec3_t p0, vec3_t p1, float tmax, float* t, vec3_t* point) {
+    vec3_t  e   = vec3_sub(p1, p0);
+    vec3_t  d   = vec3_sub(c0, p0);
+    float   ee  = vec3_dot(e, e);
+    float   em  = vec3_dot(e, m);
+    float   ed  = vec3_dot(e, d);
+    float   a   = ee * vec3_dot(m, m) - em * em;
+    float   b   = 2.0f * (ee * vec3_dot(d, m) - ed * em);
+    float   c   = ee * (vec3_dot(d, d) - r * r) - ed * ed;
+    float   root;
+
+    if( ee <= 0.0f || !lowest_root(a, b, c, tmax, &root) ) return false;
+
+    float   f   = (ed + root * em) / ee;
+    if( f < 0.0f || f > 1.0f ) return false;
+
+    *t      = root;
+    *point  = vec3_add(p0, vec3_mulf(e, f));
+    return true;
+}
+
+///
+/// edges and vertices of a triangle whose plane contact point fell outside of it. A sphere
+/// already touching the triangle hits at t = 0 at the closest point.
+///
+static
+bool
+sweep_outside(vec3_t c0, float r, vec3_t m, vec3_t v0, vec3_t v1, vec3_t v2, float tmax, float* t, vec3_t* point) {
+    vec3_t  cp  = closest_point_on_tri3(v0, v1, v2, c0, NULL);
+    vec3_t  d   = vec3_sub(c0, cp);
+    if( vec3_dot(d, d) <= r * r ) {
+        *t      = 0.0f;
+        *point  = cp;
+        return true;
+    }
+
+    vec3_t  v[3];
+    bool    found   = false;
+    float   best    = tmax;
+    float   tc;
+    vec3_t  pc;
+
+    v[0]    = v0;
+    v[1]    = v1;
+    v[2]    = v2;
+    for( int k = 0; k < 3; ++k ) {
+        if( sweep_vertex(c0, r, m, v[k], best, &tc) ) {
+            found   = true;
+            best    = tc;
+            *point  = v[k];
+        }
+        if( sweep_edge(c0, r, m, v[k], v[(k + 1) % 3], best, &tc, &pc) ) {
+            found   = true;
+            best    = tc;
+            *point  = pc;
+        }
+    }
+
+    *t  = best;
+    return found;
+}
+
+bool
+sphere_sweep_tri3_group(vec3_t center, float radius, vec3_t motion, const tri3_group_t* g, uint32_t lane_mask, float tmax, sphere_sweep_hit_t* hit) {
+    float       tt[TRI3_GROUP_SIZE];
+    float       nx[TRI3_GROUP_SIZE], ny[TRI3_GROUP_SIZE], nz[TRI3_GROUP_SIZE];
+    uint32_t    active  = 0;
+    uint32_t    outside = 0;
+
+    // swept bounds of the sphere
+    vec3_t      end     = vec3_add(center, motion);
+    vec3_t      smin    = vec3_sub(vec3_min(center, end), vec3(radius, radius, radius));
+    vec3_t      smax    = vec3_add(vec3_max(center, end), vec3(radius, radius, radius));
+
+    // bounds rejection first, most groups stop here
+    uint32_t    overlap = 0;
+    for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+        float   v1x = g->v0x[i] + g->e1x[i], v1y = g->v0y[i] + g->e1y[i], v1z = g->v0z[i] + g->e1z[i];
+        float   v2x = g->v0x[i] + g->e2x[i], v2y = g->v0y[i] + g->e2y[i], v2z = g->v0z[i] + g->e2z[i];
+        bool    o   = (MIN(g->v0x[i], MIN(v1x, v2x)) <= smax.x) & (MAX(g->v0x[i], MAX(v1x, v2x)) >= smin.x) &
+                      (MIN(g->v0y[i], MIN(v1y, v2y)) <= smax.y) & (MAX(g->v0y[i], MAX(v1y, v2y)) >= smin.y) &
+                      (MIN(g->v0z[i], MIN(v1z, v2z)) <= smax.z) & (MAX(g->v0z[i], MAX(v1z, v2z)) >= smin.z);
+        overlap |= (uint32_t)o << i;
+    }
+
+    lane_mask   &= overlap;
+    if( lane_mask == 0 ) return false;
+
+    for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+        // unit plane normal facing the sphere
+        float   px  = g->e1y[i] * g->e2z[i] - g->e1z[i] * g->e2y[i];
+        float   py  = g->e1z[i] * g->e2x[i] - g->e1x[i] * g->e2z[i];
+        float   pz  = g->e1x[i] * g->e2y[i] - g->e1y[i] * g->e2x[i];
+        float   len = sqrtf(px * px + py * py + pz * pz);
+        float   wx  = center.x - g->v0x[i];
+        float   wy  = center.y - g->v0y[i];
+        float   wz  = center.z - g->v0z[i];
+        float   inv = (wx * px + wy * py + wz * pz) < 0.0f ? -1.0f / len : 1.0f / len;
+        px  *= inv;
+        py  *= inv;
+        pz  *= inv;
+
+        float   dist    = wx * px + wy * py + wz * pz;
+        float   dn      = motion.x * px + motion.y * py + motion.z * pz;
+
+        // the sphere reaches the plane at t, already in contact with it when dist <= radius
+        float   t       = dist <= radius ? 0.0f : (dn < 0.0f ? (dist - radius) / -dn : INFINITY);
+        float   s       = dist <= radius ? dist : radius;
+        float   cx      = center.x + motion.x * t - px * s - g->v0x[i];
+        float   cy      = center.y + motion.y * t - py * s - g->v0y[i];
+        float   cz      = center.z + motion.z * t - pz * s - g->v0z[i];
+
+        // barycentrics of the plane contact point
+        float   d00 = g->e1x[i] * g->e1x[i] + g->e1y[i] * g->e1y[i] + g->e1z[i] * g->e1z[i];
+        float   d01 = g->e1x[i] * g->e2x[i] + g->e1y[i] * g->e2y[i] + g->e1z[i] * g->e2z[i];
+        float   d11 = g->e2x[i] * g->e2x[i] + g->e2y[i] * g->e2y[i] + g->e2z[i] * g->e2z[i];
+        float   d20 = cx * g->e1x[i] + cy * g->e1y[i] + cz * g->e1z[i];
+        float   d21 = cx * g->e2x[i] + cy * g->e2y[i] + cz * g->e2z[i];
+        float   det = d00 * d11 - d01 * d01;
+        float   u   = (d11 * d20 - d01 * d21);
+        float   v   = (d00 * d21 - d01 * d20);
+        bool    in  = (u >= 0.0f) & (v >= 0.0f) & (u + v <= det);
+
+        bool    ok  = (len > 0.0f) & (t <= tmax);
+        tt[i]   = ok & in ? t : INFINITY;
+        nx[i]   = px;
+        ny[i]   = py;
+        nz[i]   = pz;
+        active  |= (uint32_t)ok << i;
+        outside |= (uint32_t)(ok & !in) << i;
+    }
+
+    active  &= lane_mask;
+    outside &= lane_mask;
+    if( active == 0 ) return false;
+
+    uint32_t    best    = TRI3_GROUP_SIZE;
+    float       best_t  = tmax;
+    vec3_t      best_p  = vec3(0.0f, 0.0f, 0.0f);
+    for( uint32_t i = 0; i < TRI3_GROUP_SIZE; ++i ) {
+        if( (active & (1u << i)) && tt[i] <= best_t ) {
+            best_t  = tt[i];
+            best    = i;
+        }
+    }
+
+    if( best != TRI3_GROUP_SIZE ) {
+        vec3_t  n   = vec3(nx[best], ny[best], nz[best]);
+        vec3_t  c   = vec3_add(center, vec3_mulf(motion, best_t));
+        float   d   = vec3_dot(n, vec3_sub(c, vec3(g->v0x[best], g->v0y[best], g->v0z[best])));
+        best_p  = vec3_sub(c, vec3_mulf(n, d));
+    }
+
+    // edges and vertices of the lanes whose plane contact missed the triangle
+    uint32_t    face    = best;
+    while( outside ) {
+        uint32_t    i   = 0;
+        while( !(outside & (1u << i)) ) ++i;
+        outside &= ~(1u << i);
+
+        vec3_t  v0  = vec3(g->v0x[i], g->v0y[i], g->v0z[i]);
+        vec3_t  v1  = vec3_add(v0, vec3(g->e1x[i], g->e1y[i], g->e1z[i]));
+        vec3_t  v2  = vec3_add(v0, vec3(g->e2x[i], g->e2y[i], g->e2z[i]));
+        float   t;
+        vec3_t  p;
+        if( sweep_outside(center, radius, motion, v0, v1, v2, best_t, &t, &p) && (best == TRI3_GROUP_SIZE || t < best_t) ) {
+            best    = i;
+            best_t  = t;
+            best_p  = p;
+        }
+    }
+
+    if( best == TRI3_GROUP_SIZE ) return false;
+
+    vec3_t  c   = vec3_add(center, vec3_mulf(motion, best_t));
+    vec3_t  n   = vec3_sub(c, best_p);
+    float   len = vec3_length(n);
+
+    hit->t      = best_t;
+    hit->point  = best_p;
+    hit->normal = best == face || len <= 0.0f ? vec3(nx[best], ny[best], nz[best]) : vec3_divf(n, len);
+    hit->tri    = g->tri[best];
+    return true;
+}
+
+bool
+sphere_sweep_tri3_groups(vec3_t center, float radius, vec3_t motion, const tri3_group_t* groups, uint32_t group_count, sphere_sweep_hit_t* hit) {
+    bool        found   = false;
+    float       tmax    = 1.0f;
+
+    for( uint32_t i = 0; i < group_count; ++i ) {
+        if( sphere_sweep_tri3_group(center, radius, motion, &groups[i], TRI3_GROUP_MASK_ALL, tmax, hit) ) {
+            found   = true;
+            tmax    = hit->t;
+            if( tmax == 0.0f ) break;
+        }
+    }
+
+    return found;
+}
@@ -34,7 +34,7 @@ cube_table[8] = {
 };
 
 void
-box3_subdivide(box3_t bbox, box3_t out[3]) {
+box3_subdivide(box3_t bbox, box3_t out[8]) {
     vec3_t  ps[2] = { bbox.min, bbox.max };
 
     vec3_t  vs[8];
@@ -48,3 +48,17 @@ box3_subdivide(box3_t bbox, box3_t out[3]) {
         out[i] = box3(vec3_min(center, vs[i]), vec3_max(center, vs[i]));
     }
 }
+
+/* inverse of cube_table: (x | y << 1 | z << 2) -> subdivision index */
+static
+uint32_t
+octant_table[8] = { 4, 5, 0, 1, 7, 6, 3, 2 };
+
+uint32_t
+box3_octant(box3_t bbox, vec3_t pt) {
+    vec3_t      center  = box3_center(bbox);
+    uint32_t    x   = pt.x >= center.x ? 1 : 0;
+    uint32_t    y   = pt.y >= center.y ? 1 : 0;
+    uint32_t    z   = pt.z >= center.z ? 1 : 0;
+    return octant_table[x | (y << 1) | (z << 2)];
+}
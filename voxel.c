@@ -0,0 +1,208 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool
+voxel_grid_init(voxel_grid_t* g, box3_t domain, ivec3_t dims) {
+    memset(g, 0, sizeof(voxel_grid_t));
+    if( dims.x < 1 || dims.y < 1 || dims.z < 1 ) return false;
+
+    vec3_t  ext     = vec3_sub(domain.max, domain.min);
+    g->domain       = domain;
+    g->dims         = dims;
+    g->cell         = vec3(ext.x / (float)dims.x, ext.y / (float)dims.y, ext.z / (float)dims.z);
+    g->word_count   = (uint32_t)(((uint64_t)dims.x * (uint64_t)dims.y * (uint64_t)dims.z + 63) / 64);
+    g->bits         = (uint64_t*)calloc(g->word_count, sizeof(uint64_t));
+    return g->bits != NULL;
+}
+
+void
+voxel_grid_release(voxel_grid_t* g) {
+    free(g->bits);
+    memset(g, 0, sizeof(voxel_grid_t));
+}
+
+void
+voxel_grid_clear(voxel_grid_t* g) {
+    memset(g->bits, 0, sizeof(uint64_t) * g->word_count);
+}
+
+uint32_t
+voxel_grid_count(const voxel_grid_t* g) {
+    uint32_t    count   = 0;
+    for( uint32_t w = 0; w < g->word_count; ++w ) {
+        uint64_t    b   = g->bits[w];
+        while( b ) {
+            b   &= b - 1;
+            ++count;
+        }
+    }
+    return count;
+}
+
+static INLINE
+void
+set_cell(voxel_grid_t* g, uint32_t i) {
+    uint64_t    bit = (uint64_t)1 << (i & 63);
+    uint64_t    cur;
+
+    // most cells are hit by several triangles, skip the atomic when already set
+#pragma omp atomic read
+    cur = g->bits[i >> 6];
+    if( cur & bit ) return;
+
+#pragma omp atomic
+    g->bits[i >> 6] |= bit;
+}
+
+/* cell range [lo, hi] of the interval [a, b] along an axis, false if outside the grid */
+static INLINE
+bool
+cell_range(float a, float b, float origin, float cell, int count, int* lo, int* hi) {
+    int     l   = (int)floorf((a - origin) / cell);
+    int     h   = (int)floorf((b - origin) / cell);
+    if( h < 0 || l >= count ) return false;
+    *lo = l > 0 ? l : 0;
+    *hi = h < count - 1 ? h : count - 1;
+    return true;
+}
+
+static
+void
+conservative(voxel_grid_t* g, vec3_t v0, vec3_t v1, vec3_t v2) {
+    box3_t  tb  = box3_expand(box3(v0, v1), v2);
+    int     x0, x1, y0, y1, z0, z1;
+
+    if( !cell_range(tb.min.x, tb.max.x, g->domain.min.x, g->cell.x, g->dims.x, &x0, &x1) ||
+        !cell_range(tb.min.y, tb.max.y, g->domain.min.y, g->cell.y, g->dims.y, &y0, &y1) ||
+        !cell_range(tb.min.z, tb.max.z, g->domain.min.z, g->cell.z, g->dims.z, &z0, &z1) ) return;
+
+    for( int z = z0; z <= z1; ++z ) {
+        for( int y = y0; y <= y1; ++y ) {
+            for( int x = x0; x <= x1; ++x ) {
+                vec3_t  lo  = vec3(g->domain.min.x + (float)x * g->cell.x,
+                                   g->domain.min.y + (float)y * g->cell.y,
+                                   g->domain.min.z + (float)z * g->cell.z);
+                box3_t  cb  = box3(lo, vec3_add(lo, g->cell));
+                if( intersect_box3_tri3(cb, v0, v1, v2) ) {
+                    set_cell(g, voxel_grid_index(g, x, y, z));
+                }
+            }
+        }
+    }
+}
+
+/* 2d edge ownership for points exactly on an edge of a counter clockwise triangle */
+static INLINE
+bool
+edge_inside(double ax, double ay, double bx, double by, double px, double py) {
+    double  e   = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+    return e > 0.0 || (e == 0.0 && (by - ay > 0.0 || (by - ay == 0.0 && bx - ax < 0.0)));
+}
+
+///
+/// thin surface along one axis: the triangle is rasterized onto the columns of cell centers
+/// perpendicular to the axis, and each covered column marks the cell holding the crossing.
+/// A center exactly on an edge shared by two triangles is owned by one of them.
+///
+static
+void
+surface_axis(voxel_grid_t* g, const vec3_t v[3], int axis) {
+    int     au      = (axis + 1) % 3;
+    int     av      = (axis + 2) % 3;
+    int     n[3]    = { g->dims.x, g->dims.y, g->dims.z };
+    float   lo[3]   = { g->domain.min.x, g->domain.min.y, g->domain.min.z };
+    float   cs[3]   = { g->cell.x, g->cell.y, g->cell.z };
+    double  u[3], w[3], d[3];
+
+    for( int k = 0; k < 3; ++k ) {
+        u[k]    = (double)vec3_axis(v[k], au);
+        w[k]    = (double)vec3_axis(v[k], av);
+        d[k]    = (double)vec3_axis(v[k], axis);
+    }
+
+    double  area    = (u[1] - u[0]) * (w[2] - w[0]) - (w[1] - w[0]) * (u[2] - u[0]);
+    if( area == 0.0 ) return;
+    if( area < 0.0 ) {
+        double  tmp;
+        tmp = u[1]; u[1] = u[2]; u[2] = tmp;
+        tmp = w[1]; w[1] = w[2]; w[2] = tmp;
+        tmp = d[1]; d[1] = d[2]; d[2] = tmp;
+        area    = -area;
+    }
+
+    // columns whose centers fall in the projected bounds
+    double  umin    = MIN(u[0], MIN(u[1], u[2]));
+    double  umax    = MAX(u[0], MAX(u[1], u[2]));
+    double  wmin    = MIN(w[0], MIN(w[1], w[2]));
+    double  wmax    = MAX(w[0], MAX(w[1], w[2]));
+    int     iu0     = (int)ceil((umin - lo[au]) / cs[au] - 0.5);
+    int     iu1     = (int)floor((umax - lo[au]) / cs[au] - 0.5);
+    int     iw0     = (int)ceil((wmin - lo[av]) / cs[av] - 0.5);
+    int     iw1     = (int)floor((wmax - lo[av]) / cs[av] - 0.5);
+    iu0 = iu0 > 0 ? iu0 : 0;
+    iw0 = iw0 > 0 ? iw0 : 0;
+    iu1 = iu1 < n[au] - 1 ? iu1 : n[au] - 1;
+    iw1 = iw1 < n[av] - 1 ? iw1 : n[av] - 1;
+
+    for( int iw = iw0; iw <= iw1; ++iw ) {
+        for( int iu = iu0; iu <= iu1; ++iu ) {
+            double  pu  = (double)(lo[au] + ((float)iu + 0.5f) * cs[au]);
+            double  pw  = (double)(lo[av] + ((float)iw + 0.5f) * cs[av]);
+            if( !edge_inside(u[0], w[0], u[1], w[1], pu, pw) ||
+                !edge_inside(u[1], w[1], u[2], w[2], pu, pw) ||
+                !edge_inside(u[2], w[2], u[0], w[0], pu, pw) ) continue;
+
+            double  b1  = ((pu - u[0]) * (w[2] - w[0]) - (pw - w[0]) * (u[2] - u[0])) / area;
+            double  b2  = ((u[1] - u[0]) * (pw - w[0]) - (w[1] - w[0]) * (pu - u[0])) / area;
+            double  z   = d[0] + b1 * (d[1] - d[0]) + b2 * (d[2] - d[0]);
+            double  fi  = floor((z - lo[axis]) / cs[axis]);
+            if( fi < 0.0 || fi >= (double)n[axis] ) continue;
+
+            int     c[3];
+            c[au]   = iu;
+            c[av]   = iw;
+            c[axis] = (int)fi;
+            set_cell(g, voxel_grid_index(g, c[0], c[1], c[2]));
+        }
+    }
+}
+
+void
+voxelize_tri3(voxel_grid_t* g, tri3_mesh_t mesh, voxelize_mode_t mode) {
+#pragma omp parallel for schedule(dynamic, 256)
+    for( int t = 0; t < (int)mesh.tri_count; ++t ) {
+        vec3_t  v[3];
+        tri3_mesh_triangle(mesh, (uint32_t)t, &v[0], &v[1], &v[2]);
+
+        if( mode == VOXELIZE_CONSERVATIVE ) {
+            conservative(g, v[0], v[1], v[2]);
+        } else {
+            surface_axis(g, v, 0);
+            surface_axis(g, v, 1);
+            surface_axis(g, v, 2);
+        }
+    }
+}
@@ -0,0 +1,162 @@
+/*
+** 3D math library Copyright 2015(c) Wael El Oraiby. All Rights Reserved
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Under Section 7 of GPL version 3, you are granted additional
+** permissions described in the GCC Runtime Library Exception, version
+** 3.1, as published by the Free Software Foundation.
+**
+** You should have received a copy of the GNU General Public License and
+** a copy of the GCC Runtime Library Exception along with this program;
+** see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+** <http://www.gnu.org/licenses/>.
+**
+*/
+#define BUILDING_3DMATH_DLL
+#include "3dmath.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define WELD_CELL_SCALE     4.0f    /* cell side over the tolerance */
+
+typedef struct {
+    const vec3_t*   positions;
+    const vec3_t*   normals;
+    const vec2_t*   uvs;
+    float           e;
+    float           e2;
+    float           ne2;
+    float           te2;
+} weld_t;
+
+/* attributes of two vertices within tolerance of each other */
+static INLINE
+bool
+attributes_match(const weld_t* w, uint32_t a, uint32_t b) {
+    if( w->normals ) {
+        vec3_t  n   = vec3_sub(w->normals[a], w->normals[b]);
+        if( vec3_dot(n, n) > w->ne2 ) return false;
+    }
+    if( w->uvs ) {
+        vec2_t  t   = vec2_sub(w->uvs[a], w->uvs[b]);
+        if( vec2_dot(t, t) > w->te2 ) return false;
+    }
+    return true;
+}
+
+/* smallest matching index before i, among representatives only when reps is set */
+static
+uint32_t
+first_match(const hash_grid_t* g, const weld_t* w, uint32_t i, const uint32_t* reps) {
+    vec3_t      p       = w->positions[i];
+    ivec3_t     lo      = hash_grid_cell(g, vec3_sub(p, vec3(w->e, w->e, w->e)));
+    ivec3_t     hi      = hash_grid_cell(g, vec3_add(p, vec3(w->e, w->e, w->e)));
+    uint32_t    best    = i;
+
+    for( int z = lo.z; z <= hi.z; ++z ) {
+        for( int y = lo.y; y <= hi.y; ++y ) {
+            for( int x = lo.x; x <= hi.x; ++x ) {
+                ivec3_t     c   = ivec3(x, y, z);
+                uint32_t    b   = hash_grid_bucket(g, c);
+                for( uint32_t k = g->bucket_start[b]; k < g->bucket_start[b + 1]; ++k ) {
+                    uint32_t    j   = g->indices[k];
+                    vec3_t      d   = vec3_sub(g->positions[k], p);
+                    if( j >= best || vec3_dot(d, d) > w->e2 || !ivec3_eq(g->cells[k], c) ) continue;
+                    if( reps && reps[j] != j ) continue;
+                    if( attributes_match(w, i, j) ) best = j;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+uint32_t
+weld_vertices(const vec3_t* positions, const vec3_t* normals, const vec2_t* uvs, uint32_t count, float epsilon, float normal_epsilon, float uv_epsilon, uint32_t* remap, uint32_t* unique) {
+    weld_t      w       = { positions, normals, uvs, epsilon, epsilon * epsilon, normal_epsilon * normal_epsilon, uv_epsilon * uv_epsilon };
+    hash_grid_t g;
+    uint32_t*   first;
+    uint32_t    table   = count > 0x40000000u ? 0x80000000u : count * 2;
+    uint32_t    unique_count = 0;
+
+    if( count == 0 ) return 0;
+
+    // with cells of a few tolerances the ball around a vertex mostly overlaps
+    // one to four cells, cell coordinates must not overflow either
+    box3_t      bounds  = box3_from_points(positions, count);
+    float       ext     = MAX(MAX(fabsf(bounds.min.x), fabsf(bounds.max.x)), MAX(MAX(fabsf(bounds.min.y), fabsf(bounds.max.y)), MAX(fabsf(bounds.min.z), fabsf(bounds.max.z))));
+    float       cell    = MAX(WELD_CELL_SCALE * epsilon, ext * (1.0f / 1073741824.0f));
+    if( !(cell > 0.0f) ) cell = 1.0f;
+
+    first   = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    if( !first ) return 0;
+    if( !hash_grid_init(&g, cell, table, count) || !hash_grid_build(&g, positions, count) ) {
+        hash_grid_release(&g);
+        free(first);
+        return 0;
+    }
+
+    // in bucket order, duplicates sharing a cell then reuse the same cache lines
+#pragma omp parallel for schedule(dynamic, 1024)
+    for( int k = 0; k < (int)count; ++k )
+        first[g.indices[k]] = first_match(&g, &w, g.indices[k], NULL);
+
+    // greedy in index order: a vertex joins the smallest earlier
+    // representative it matches. The smallest match is usually one already,
+    // only chains of near but not matching vertices need a second look.
+    for( uint32_t i = 0; i < count; ++i ) {
+        uint32_t    j   = first[i];
+        if( j != i && first[j] != j ) j = first_match(&g, &w, i, first);
+        first[i]    = j;
+    }
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        if( first[i] == i ) {
+            if( unique ) unique[unique_count] = i;
+            remap[i]    = unique_count++;
+        } else {
+            remap[i]    = remap[first[i]];
+        }
+    }
+
+    hash_grid_release(&g);
+    free(first);
+    return unique_count;
+}
+
+void
+weld_gather_vec3(const vec3_t* in, const uint32_t* unique, uint32_t unique_count, vec3_t* out) {
+#pragma omp parallel for
+    for( int i = 0; i < (int)unique_count; ++i )
+        out[i]  = in[unique[i]];
+}
+
+void
+weld_gather_vec2(const vec2_t* in, const uint32_t* unique, uint32_t unique_count, vec2_t* out) {
+#pragma omp parallel for
+    for( int i = 0; i < (int)unique_count; ++i )
+        out[i]  = in[unique[i]];
+}
+
+uint32_t
+weld_remap_triangles(uint32_t* indices, uint32_t tri_count, const uint32_t* remap) {
+    uint32_t    kept    = 0;
+
+    for( uint32_t t = 0; t < tri_count; ++t ) {
+        uint32_t    a   = remap[indices[t * 3]];
+        uint32_t    b   = remap[indices[t * 3 + 1]];
+        uint32_t    c   = remap[indices[t * 3 + 2]];
+        if( a == b || b == c || c == a ) continue;
+
+        indices[kept * 3]       = a;
+        indices[kept * 3 + 1]   = b;
+        indices[kept * 3 + 2]   = c;
+        ++kept;
+    }
+    return kept;
+}